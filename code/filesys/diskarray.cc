@@ -0,0 +1,337 @@
+// diskarray.cc
+//	Routines to use several simulated disks as one: striping sectors
+//	across them, and optionally mirroring each disk onto a twin.
+//
+//	Each disk has a queue of requests.  A thread puts the requests
+//	for all the sectors it wants on the queues at once, and then
+//	waits for them all; meanwhile the disks work through their
+//	queues independently, each starting its next request from its
+//	own interrupt handler.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "diskarray.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// DiskUnit::DiskUnit
+// 	Open one of this machine's disks, with nothing for it to do.
+//
+//	"unit" -- which disk
+//----------------------------------------------------------------------
+
+DiskUnit::DiskUnit(int unit)
+{
+    disk = new Disk(this, unit);
+    queue = new List<DiskIO *>;
+    current = NULL;
+    numRequests = 0;
+}
+
+//----------------------------------------------------------------------
+// DiskUnit::~DiskUnit
+// 	Close the disk.  Nobody can be waiting for it.
+//----------------------------------------------------------------------
+
+DiskUnit::~DiskUnit()
+{
+    ASSERT(current == NULL && queue->IsEmpty());
+    delete disk;
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// DiskUnit::StartNext
+// 	Give the disk the request at the front of the queue, if there
+//	is one.  Called with interrupts off, when the disk is idle.
+//----------------------------------------------------------------------
+
+void
+DiskUnit::StartNext()
+{
+    ASSERT(current == NULL);
+    if (queue->IsEmpty()) {
+	return;
+    }
+    current = queue->RemoveFront();
+    if (current->writing) {
+	disk->WriteRequest(current->sector, current->data);
+    } else {
+	disk->ReadRequest(current->sector, current->data);
+    }
+}
+
+//----------------------------------------------------------------------
+// DiskUnit::Submit
+// 	Queue a request for the disk, starting it right away if the
+//	disk is idle.  Returns without waiting for it.  The request is
+//	deleted once it is done.
+//
+//	"io" -- the request
+//----------------------------------------------------------------------
+
+void
+DiskUnit::Submit(DiskIO *io)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    queue->Append(io);
+    numRequests++;
+    if (current == NULL) {
+	StartNext();
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// DiskUnit::CallBack
+// 	Disk interrupt handler.  Wake up whoever is waiting for the
+//	request that just finished, and start the next one.
+//----------------------------------------------------------------------
+
+void
+DiskUnit::CallBack()
+{
+    Semaphore *done = current->done;
+
+    delete current;
+    current = NULL;
+    StartNext();
+    done->V();
+}
+
+//----------------------------------------------------------------------
+// UnitSize
+// 	Return the size of this machine's disk "unit" (in the UNIX file
+//	Disk keeps it in), or -1 if it doesn't exist yet.
+//----------------------------------------------------------------------
+
+static int
+UnitSize(int unit)
+{
+    char name[32];
+    int fd, size;
+
+    sprintf(name, "DISK_%d_%d", kernel->hostName, unit);
+    fd = OpenForReadWrite(name, FALSE);
+    if (fd < 0) {
+	return -1;
+    }
+    Lseek(fd, 0, SEEK_END);
+    size = Tell(fd);
+    Close(fd);
+    return size;
+}
+
+//----------------------------------------------------------------------
+// DiskArray::DiskArray
+// 	Open the disks of the array.  They are this machine's disks 0
+//	through stripes - 1, and then their twins.
+//
+//	A disk that doesn't exist yet is created empty.  That's no good
+//	for a twin: reads would be sent to it as often as to the disk
+//	that has the data.  So unless the array is about to be formatted,
+//	refuse to start if either of a pair is missing, or they differ
+//	in size.
+//
+//	"stripes" -- how many disks to stripe sectors across
+//	"mirrored" -- should each have a twin?
+//	"format" -- is the file system about to be formatted?
+//----------------------------------------------------------------------
+
+DiskArray::DiskArray(int stripes, bool mirrored, bool format)
+    : SynchDisk(FALSE)
+{
+    int numUnits = mirrored ? 2 * stripes : stripes;
+
+    ASSERT(0 < stripes && stripes <= MaxStripeDisks);
+    for (int i = 0; mirrored && !format && i < stripes; i++) {
+	int size = UnitSize(i);
+	int twinSize = UnitSize(i + stripes);
+
+	if (size != twinSize) {
+	    cerr << "Disk array: disk " << i << " and its twin, disk "
+		 << i + stripes << ", " << ((size < 0 || twinSize < 0) ?
+		 "aren't both there" : "differ in size")
+		 << "; remove them, and use -f to start over\n";
+	    Exit(1);
+	}
+    }
+    numStripes = stripes;
+    mirror = mirrored;
+    units = new DiskUnit *[numUnits];
+    for (int i = 0; i < numUnits; i++) {
+	units[i] = new DiskUnit(i);
+    }
+    nextTwin = 0;
+}
+
+//----------------------------------------------------------------------
+// DiskArray::~DiskArray
+// 	Close the disks.
+//----------------------------------------------------------------------
+
+DiskArray::~DiskArray()
+{
+    int numUnits = mirror ? 2 * numStripes : numStripes;
+
+    for (int i = 0; i < numUnits; i++) {
+	delete units[i];
+    }
+    delete [] units;
+}
+
+//----------------------------------------------------------------------
+// DiskArray::Submit
+// 	Queue the request(s) for one sector: a write goes to the disk the
+//	sector is striped onto and its twin, if it has one; a read goes
+//	to whichever of the two has fewer requests ahead of it, taking
+//	turns when they are even.  Returns how many requests it queued,
+//	each of which V's "done" when it is finished.
+//
+//	"writing" -- write the sector, or read it?
+//	"sectorNumber" -- the sector, as the file system numbers them
+//	"data" -- where the sector's contents come from or go
+//	"done" -- semaphore to V as each request finishes
+//----------------------------------------------------------------------
+
+int
+DiskArray::Submit(bool writing, int sectorNumber, char *data,
+			Semaphore *done)
+{
+    int unit = sectorNumber % numStripes;
+    int twin = unit + numStripes;
+    DiskIO *io;
+
+    ASSERT(0 <= sectorNumber && sectorNumber < NumSectors);
+    if (mirror && !writing) {
+	int mine = units[unit]->QueueLength();
+	int its = units[twin]->QueueLength();
+
+	if (its < mine || (its == mine && nextTwin == 1)) {
+	    unit = twin;
+	}
+	nextTwin = 1 - nextTwin;
+    }
+
+    io = new DiskIO;
+    io->writing = writing;
+    io->sector = sectorNumber / numStripes;
+    io->data = data;
+    io->done = done;
+    units[unit]->Submit(io);
+    if (!(mirror && writing)) {
+	return 1;
+    }
+    io = new DiskIO;
+    io->writing = TRUE;
+    io->sector = sectorNumber / numStripes;
+    io->data = data;
+    io->done = done;
+    units[twin]->Submit(io);
+    return 2;
+}
+
+//----------------------------------------------------------------------
+// DiskArray::ReadSector
+// 	Read the contents of a sector into a buffer.  Return only after
+//	the data has been read.
+//
+//	"sectorNumber" -- the sector to read
+//	"data" -- the buffer to hold the contents of the sector
+//----------------------------------------------------------------------
+
+void
+DiskArray::ReadSector(int sectorNumber, char* data)
+{
+    ReadSectors(1, &sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// DiskArray::WriteSector
+// 	Write the contents of a buffer into a sector (and its mirror).
+//	Return only after the data has been written.
+//
+//	"sectorNumber" -- the sector to be written
+//	"data" -- the new contents of the sector
+//----------------------------------------------------------------------
+
+void
+DiskArray::WriteSector(int sectorNumber, char* data)
+{
+    WriteSectors(1, &sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// DiskArray::ReadSectors
+// 	Read the contents of several sectors, queueing all the requests
+//	before waiting for any, so the disks work on them together.
+//
+//	"numSectors" -- how many sectors to read
+//	"sectors" -- which ones
+//	"data" -- the buffer to hold their contents, in the same order
+//----------------------------------------------------------------------
+
+void
+DiskArray::ReadSectors(int numSectors, int *sectors, char *data)
+{
+    Semaphore *done = new Semaphore("disk array", 0);
+    int requests = 0;
+
+    for (int i = 0; i < numSectors; i++) {
+	requests += Submit(FALSE, sectors[i], &data[i * SectorSize], done);
+    }
+    for (int i = 0; i < requests; i++) {
+	done->P();
+    }
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// DiskArray::WriteSectors
+// 	Write the contents of several sectors, all at once.
+//
+//	"numSectors" -- how many sectors to write
+//	"sectors" -- which ones
+//	"data" -- their new contents, in the same order
+//----------------------------------------------------------------------
+
+void
+DiskArray::WriteSectors(int numSectors, int *sectors, char *data)
+{
+    Semaphore *done = new Semaphore("disk array", 0);
+    int requests = 0;
+
+    for (int i = 0; i < numSectors; i++) {
+	requests += Submit(TRUE, sectors[i], &data[i * SectorSize], done);
+    }
+    for (int i = 0; i < requests; i++) {
+	done->P();
+    }
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// DiskArray::PrintStats
+// 	Print how many requests each disk of the array was given.
+//----------------------------------------------------------------------
+
+void
+DiskArray::PrintStats()
+{
+    int numUnits = mirror ? 2 * numStripes : numStripes;
+
+    SynchDisk::PrintStats();
+    cout << "Disk array: " << numStripes << " disks striped";
+    if (mirror) {
+	cout << ", mirrored";
+    }
+    cout << ", requests per disk";
+    for (int i = 0; i < numUnits; i++) {
+	cout << " " << units[i]->NumRequests();
+    }
+    cout << "\n";
+}
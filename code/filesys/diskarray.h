@@ -0,0 +1,112 @@
+// diskarray.h
+//	Data structures for a synchronous disk made of several simulated
+//	disks, so that a request for many sectors can keep them all busy
+//	at once.
+//
+//	Sectors are striped across the disks, one at a time: with "n"
+//	disks, sector s is sector s / n of disk s % n, so consecutive
+//	sectors are on different disks (RAID-0).  Each disk still does
+//	one request at a time, but they work at the same time.
+//
+//	The array can also be mirrored (RAID-1 on top): every disk has a
+//	twin holding the same sectors.  Writes go to both; a read goes
+//	to whichever twin has less waiting for it.  So both must really
+//	hold the same sectors: Nachos won't start on a mirrored array
+//	where a disk's twin is missing, or a different size, unless it
+//	is formatting the array anyway.  There is no degraded mode.
+//
+//	The file system still sees NumSectors sectors, so striping buys
+//	bandwidth, not space: each disk only uses 1/n of itself.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DISKARRAY_H
+#define DISKARRAY_H
+
+#include "disk.h"
+#include "synchdisk.h"
+#include "synch.h"
+#include "list.h"
+#include "callback.h"
+
+// Most disks an array can be striped across
+
+const int MaxStripeDisks = 8;
+
+// A request to one disk of the array.
+
+class DiskIO {
+  public:
+    bool writing;		// write, or read?
+    int sector;			// sector on that disk
+    char *data;			// where the data comes from or goes
+    Semaphore *done;		// V'ed when it is done
+};
+
+// The following class defines one disk of the array, and the requests
+// waiting for it.  When the disk finishes a request, its interrupt
+// handler starts the next one, so the disk never waits for a thread
+// to be scheduled.
+
+class DiskUnit : public CallBackObj {
+  public:
+    DiskUnit(int unit);		// Open this machine's disk "unit"
+    ~DiskUnit();
+
+    void Submit(DiskIO *io);	// Do "io" once the requests ahead of
+				// it are done; V its semaphore when it is
+    int QueueLength() { return queue->NumInList() + (current != NULL); }
+				// Requests waiting or in progress
+    int NumRequests() { return numRequests; }
+
+    void CallBack();		// Called by the disk when a request is
+				// done
+
+  private:
+    Disk *disk;			// the simulated disk
+    List<DiskIO *> *queue;	// requests waiting for it
+    DiskIO *current;		// the request it is doing, or NULL
+    int numRequests;		// requests it has been given
+
+    void StartNext();		// Give the disk the next request
+};
+
+// The following class defines the whole array, as a synchronous disk.
+
+class DiskArray : public SynchDisk {
+  public:
+    DiskArray(int stripes, bool mirrored, bool format);
+				// Stripe across "stripes" disks, each
+				// with a twin if "mirrored"; "format" if
+				// the file system is about to be
+    ~DiskArray();
+
+    void ReadSector(int sectorNumber, char* data);
+    void WriteSector(int sectorNumber, char* data);
+				// Read/write one sector, and wait for it
+
+    void ReadSectors(int numSectors, int *sectors, char *data);
+    void WriteSectors(int numSectors, int *sectors, char *data);
+				// Read/write several, all at once
+
+    void PrintStats();		// Print how busy each disk was
+
+  private:
+    int numStripes;		// disks the sectors are spread across
+    bool mirror;		// does each have a twin?
+    DiskUnit **units;		// the disks: the twin of disk i, if
+				// any, is disk i + numStripes
+    int nextTwin;		// which twin gets a read when both
+				// are equally busy
+
+    int Submit(bool writing, int sectorNumber, char *data,
+		Semaphore *done);
+				// Send one sector's request to its disk(s);
+				// return how many requests that made
+};
+
+#endif // DISKARRAY_H
@@ -123,6 +123,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     }
 
     int i, firstSector, lastSector, numSectors;
+    int *sectors;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -135,14 +136,17 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
+    // read in all the full and partial sectors that we need, all
+    // at once, so a disk that can overlap requests gets the chance
     buf = new char[numSectors * SectorSize];
+    sectors = new int[numSectors];
     for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-					&buf[(i - firstSector) * SectorSize]);
+        sectors[i - firstSector] = hdr->ByteToSector(i * SectorSize);
+    kernel->synchDisk->ReadSectors(numSectors, sectors, buf);
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
+    delete [] sectors;
     delete [] buf;
     return numBytes;
 }
@@ -158,6 +162,7 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     }
     int i, firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
+    int *sectors;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -189,9 +194,11 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
 // write modified sectors back
+    sectors = new int[numSectors];
     for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-					&buf[(i - firstSector) * SectorSize]);
+        sectors[i - firstSector] = hdr->ByteToSector(i * SectorSize);
+    kernel->synchDisk->WriteSectors(numSectors, sectors, buf);
+    delete [] sectors;
     delete [] buf;
     return numBytes;
 }
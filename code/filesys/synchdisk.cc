@@ -16,6 +16,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "main.h"
 
 
 //----------------------------------------------------------------------
@@ -23,13 +24,15 @@
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"local" -- FALSE if a subclass provides the disk some other way, 
+//		so this machine's DISK_<id> shouldn't be opened
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk()
+SynchDisk::SynchDisk(bool local)
 {
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
-    disk = new Disk(this);
+    disk = local ? new Disk(this) : NULL;
 }
 
 //----------------------------------------------------------------------
@@ -81,6 +84,53 @@ SynchDisk::WriteSector(int sectorNumber, char* data)
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read the contents of several disk sectors.  The local disk can 
+//	only do one request at a time, so this is just one after another.
+//
+//	"numSectors" -- how many sectors to read
+//	"sectors" -- which ones
+//	"data" -- the buffer to hold their contents, in the same order
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int numSectors, int *sectors, char *data)
+{
+    for (int i = 0; i < numSectors; i++) {
+	ReadSector(sectors[i], &data[i * SectorSize]);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write the contents of several disk sectors, one after another.
+//
+//	"numSectors" -- how many sectors to write
+//	"sectors" -- which ones
+//	"data" -- their new contents, in the same order
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int numSectors, int *sectors, char *data)
+{
+    for (int i = 0; i < numSectors; i++) {
+	WriteSector(sectors[i], &data[i * SectorSize]);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PrintStats
+// 	Print how many requests the disk has handled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::PrintStats()
+{
+    cout << "Disk I/O: reads " << kernel->stats->numDiskReads;
+    cout << ", writes " << kernel->stats->numDiskWrites << "\n";
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
 // 	Disk interrupt handler.  Wake up any thread waiting for the disk
@@ -25,27 +25,40 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// The disk need not be on this machine: NetworkDisk (network/netdisk.h)
+// is a SynchDisk that sends its requests to another machine's, and
+// can have several of them on their way at once.
 
 class SynchDisk : public CallBackObj {
   public:
-    SynchDisk();    		        // Initialize a synchronous disk,
-					// by initializing the raw Disk.
-    ~SynchDisk();			// De-allocate the synch disk data
+    SynchDisk(bool local = TRUE);	// Initialize a synchronous disk,
+					// by initializing the raw Disk, 
+					// unless the disk is elsewhere
+    virtual ~SynchDisk();		// De-allocate the synch disk data
     
-    void ReadSector(int sectorNumber, char* data);
+    virtual void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
 					// or written.  These call
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
-    void WriteSector(int sectorNumber, char* data);
+    virtual void WriteSector(int sectorNumber, char* data);
+
+    virtual void ReadSectors(int numSectors, int *sectors, char *data);
+					// Read/write several sectors, into or
+					// out of consecutive SectorSize pieces
+					// of "data"
+    virtual void WriteSectors(int numSectors, int *sectors, char *data);
+
+    virtual void PrintStats();		// Print how much the disk was used
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
-    Disk *disk;		  		// Raw disk device
+    Disk *disk;		  		// Raw disk device, or NULL
     Semaphore *semaphore; 		// To synchronize requesting thread 
 					// with the interrupt handler
     Lock *lock;		  		// Only one read/write request
@@ -9,14 +9,15 @@
 #include "copyright.h"
 #include "utility.h"
 #include "debug.h" 
-#include "string.h"
 
 //----------------------------------------------------------------------
 // Debug::Debug
 //      Initialize so that only DEBUG messages with a flag in flagList 
 //	will be printed.
 //
-//	If the flag is "+", we enable all DEBUG messages.
+//	If the flag is "+", we enable all DEBUG messages.  The list is
+//	turned into a mask here, once, so that checking a flag is cheap:
+//	there are DEBUG statements on every simulated instruction.
 //
 // 	"flagList" is a string of characters for whose DEBUG messages are 
 //		to be enabled.
@@ -24,22 +25,16 @@
 
 Debug::Debug(char *flagList)
 {
-    enableFlags = flagList;
-}
-
-
-//----------------------------------------------------------------------
-// Debug::IsEnabled
-//      Return TRUE if DEBUG messages with "flag" are to be printed.
-//----------------------------------------------------------------------
-
-bool
-Debug::IsEnabled(char flag)
-{
-    if (enableFlags != NULL) {
-	return ((strchr(enableFlags, flag) != 0) 
-		|| (strchr(enableFlags, '+') != 0));
-    } else {
-    	return FALSE;
+    enableMask = 0;
+    if (flagList == NULL) {
+	return;
+    }
+    for (char *flag = flagList; *flag != '\0'; flag++) {
+	if (*flag == dbgAll) {
+	    enableMask = ~(DebugMask) 0;
+	} else {
+	    enableMask |= DebugBit(*flag);
+	}
     }
+    enableMask &= DebugCompiled;
 }
@@ -30,14 +30,41 @@ const char dbgAddr = 'a'; 		// address spaces
 const char dbgNet = 'n'; 		// network emulation
 const char dbgSys = 'u';                // systemcall
 
+// Each flag is one bit of a mask.  Flags are letters; anything else
+// (other than dbgAll) has no bit, and so is never enabled.
+
+typedef unsigned long long DebugMask;
+
+#define DebugBit(flag)	(((flag) >= 'A' && (flag) <= 'z') ? \
+				((DebugMask) 1 << ((flag) - 'A')) : 0)
+
+// Which flags' DEBUG statements are compiled in at all.  By default,
+// all of them; to leave some out, so they cost nothing even when
+// disabled, build with e.g.
+//
+//	-DDEBUG_OMIT="(DebugBit(dbgAddr) | DebugBit(dbgInt))"
+//
+// or with -DNODEBUG to leave out every DEBUG statement.  Flags left
+// out this way are ignored on the command line.
+
+#ifndef DEBUG_OMIT
+#define DEBUG_OMIT	0
+#endif
+
+#ifdef NODEBUG
+#define DebugCompiled	((DebugMask) 0)
+#else
+#define DebugCompiled	(~(DebugMask) (DEBUG_OMIT))
+#endif
+
 class Debug {
   public:
     Debug(char *flagList);
 
-    bool IsEnabled(char flag);
+    bool IsEnabled(char flag) { return (enableMask & DebugBit(flag)) != 0; }
 
   private:
-    char *enableFlags;		// controls which DEBUG messages are printed
+    DebugMask enableMask;	// controls which DEBUG messages are printed
 };
 
 extern Debug *debug;
@@ -45,10 +72,12 @@ extern Debug *debug;
 
 //----------------------------------------------------------------------
 // DEBUG
-//      If flag is enabled, print a message.
+//      If flag is enabled, print a message.  If it is compiled out,
+//	the test is a constant, and the whole statement disappears.
 //----------------------------------------------------------------------
 #define DEBUG(flag,expr)                                                     \
-    if (!debug->IsEnabled(flag)) {} else { 				\
+    if (!(DebugCompiled & DebugBit(flag)) || !debug->IsEnabled(flag)) {} \
+    else { 								\
         cerr << expr << "\n";   				        \
     }
 
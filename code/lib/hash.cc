@@ -1,11 +1,27 @@
 // hash.cc 
 //     	Routines to manage a self-expanding hash table of arbitrary things.
 //	The hashing function is supplied by the objects being put into
-//	the table; we use chaining to resolve hash conflicts.
+//	the table; we use open addressing to resolve hash conflicts.
 //
-//	The hash table is implemented as an array of sorted lists,
-//	and we expand the hash table if the number of elements in the table
-//	gets too big.
+//	The hash table is implemented as an array of slots, each holding
+//	at most one item.  An item goes in the slot its hash value picks,
+//	its "home", or if that is taken, in the next free slot after it
+//	(wrapping around at the end).  Looking it up steps through the
+//	same slots, until it is found or an empty slot is reached.
+//
+//	To keep these runs short, we use "Robin Hood" hashing: when an
+//	item being put in the table comes to a slot whose item is closer
+//	to its own home, the two trade places, and the displaced item
+//	moves on.  So the items in a run are in order of their homes, and
+//	a lookup can stop as soon as it passes where the key would be.
+//	Removing an item shifts the rest of its run back one slot, so
+//	no "deleted" markers are left to slow down later lookups.
+//
+//	The number of slots is a power of two, and we expand the table
+//	when it gets too full.  The hash function's value is scrambled,
+//	so that every bit of it affects the top bits, which pick the 
+//	home slot: keys whose hashes differ only in a few bits, such as
+//	page addresses, are still spread evenly across the table.
 // 
 //     	NOTE: Mutual exclusion must be provided by the caller.
 //
@@ -13,9 +29,10 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
-const int InitialBuckets = 4;	// how big a hash table do we start with
-const int ResizeRatio = 3;	// when do we grow the hash table?
-const int IncreaseSizeBy = 4;	// how much do we grow table when needed?
+const int InitialSlots = 8;	// how big a hash table do we start with
+const int MaxLoad = 7;		// we grow the table when it is more 
+const int LoadScale = 8;	// than MaxLoad / LoadScale full
+const int IncreaseSizeBy = 2;	// how much do we grow table when needed?
 
 #include "copyright.h"
 
@@ -29,25 +46,32 @@ template <class Key, class T>
 HashTable<Key,T>::HashTable(Key (*get)(T x), unsigned (*hFunc)(Key x))
 { 
     numItems = 0;
-    InitBuckets(InitialBuckets);
+    InitSlots(InitialSlots);
     getKey = get;
     hash = hFunc;
 }
 
 //----------------------------------------------------------------------
-// HashTable<Key,T>::InitBuckets
-//	Initialize the bucket array for a hash table.
-//	Called by the constructor and by ReHash().
+// HashTable<Key,T>::InitSlots
+//	Initialize the slot array for a hash table, with every slot
+//	empty.  Called by the constructor and by ReHash().
+//
+//	"sz" -- how many slots; a power of two, at least 2
 //----------------------------------------------------------------------
 
 template <class Key, class T>
 void
-HashTable<Key,T>::InitBuckets(int sz)
+HashTable<Key,T>::InitSlots(int sz)
 { 
-    numBuckets = sz;
-    buckets = new Bucket[numBuckets];
+    ASSERT(sz >= 2 && (sz & (sz - 1)) == 0);
+    numSlots = sz;
+    shift = 32;
+    for (int n = sz; n > 1; n >>= 1) {
+	shift--;
+    }
+    slots = new HashSlot<T>[numSlots];
     for (int i = 0; i < sz; i++) {
-    	buckets[i] = new List<T>;
+    	slots[i].hash = 0;
     }
 }
 
@@ -60,48 +84,74 @@ template <class Key, class T>
 HashTable<Key,T>::~HashTable()
 { 
     ASSERT(IsEmpty());		// make sure table is empty
-    DeleteBuckets(buckets, numBuckets);
+    delete [] slots;
 }
 
 //----------------------------------------------------------------------
-// HashTable<Key,T>::DeleteBuckets
-//	De-Initialize the bucket array for a hash table.
-//	Called by the destructor and by ReHash().
+// HashTable<Key,T>::HashValue
+//      Return the scrambled hash value of a key, as it is stored 
+//	with the item.  Its top bits are the item's home slot.
 //----------------------------------------------------------------------
 
 template <class Key, class T>
-void
-HashTable<Key,T>::DeleteBuckets(List<T> **table, int sz)
-{ 
-    for (int i = 0; i < sz; i++) {
-    	delete table[i];
-    }
-    delete [] table;
+unsigned
+HashTable<Key, T>::HashValue(Key key) const 
+{
+    unsigned result = (*hash)(key);
+
+    result ^= result >> 16;		// scramble: the last step of 
+    result *= 0x85ebca6b;		// the MurmurHash3 hash function
+    result ^= result >> 13;
+    result *= 0xc2b2ae35;
+    result ^= result >> 16;
+    return (result == 0) ? 1 : result;	// 0 means an empty slot
 }
 
 //----------------------------------------------------------------------
-// HashTable<Key,T>::HashValue
-//      Return hash table bucket that would contain key.
+// HashTable<Key,T>::Place
+//      Put an item into the slot array, Robin Hood fashion: starting
+//	at its home slot, pass over the slots whose items are at least
+//	as far from their homes as this one would be, and take the
+//	first slot that isn't; if that has an item, it moves on in turn.
+//
+//	"h" -- the item's hash value
+//	"item" -- the thing to put in the table
 //----------------------------------------------------------------------
 
 template <class Key, class T>
-int
-HashTable<Key, T>::HashValue(Key key) const 
+void
+HashTable<Key,T>::Place(unsigned h, T item)
 {
-    int result = (*hash)(key) % numBuckets;
-    ASSERT(result >= 0 && result < numBuckets);
-    return result;
+    int slot = HomeSlot(h);
+    int distance = 0;		// how far the item is from its home
+
+    while (slots[slot].hash != 0) {
+	int theirs = Distance(slot);
+
+	if (theirs < distance) {	// take this slot, and move its 
+	    unsigned otherHash = slots[slot].hash;	// item on
+	    T other = slots[slot].item;
+
+	    slots[slot].hash = h;
+	    slots[slot].item = item;
+	    h = otherHash;
+	    item = other;
+	    distance = theirs;
+	}
+	slot = (slot + 1) & (numSlots - 1);
+	distance++;
+    }
+    slots[slot].hash = h;
+    slots[slot].item = item;
 }
 
 //----------------------------------------------------------------------
 // HashTable<Key,T>::Insert
 //      Put an item into the hashtable.
 //      
-//	Resize the table if the # of elements / # of buckets is too big.
-//	Then allocate a HashElement to keep track of the key, item pair,
-//	and add it to the right bucket.
+//	Resize the table if it is too full.  Then put the item in
+//	the slot array.
 //
-//	"key" is the key we'll use to find this item.
 //	"item" is the thing to put in the table.
 //----------------------------------------------------------------------
 
@@ -113,11 +163,11 @@ HashTable<Key,T>::Insert(T item)
 
     ASSERT(!IsInTable(key));
 
-    if ((numItems / numBuckets) >= ResizeRatio) {
+    if ((numItems + 1) * LoadScale > numSlots * MaxLoad) {
 	ReHash();
     }
 
-    buckets[HashValue(key)]->Append(item);
+    Place(HashValue(key), item);
     numItems++;
 
     ASSERT(IsInTable(key));
@@ -127,7 +177,8 @@ HashTable<Key,T>::Insert(T item)
 // HashTable<Key,T>::ReHash
 //      Increase the size of the hashtable, by 
 //	  (i) making a new table
-//	  (ii) moving all the elements into the new table
+//	  (ii) moving all the elements into the new table, using the
+//	       hash values stored with them
 //	  (iii) deleting the old table
 //----------------------------------------------------------------------
 
@@ -135,49 +186,50 @@ template <class Key, class T>
 void
 HashTable<Key,T>::ReHash()
 {
-    Bucket *oldTable = buckets;
-    int oldSize = numBuckets;
-    T item;
+    HashSlot<T> *oldSlots = slots;
+    int oldSize = numSlots;
 
     SanityCheck();
-    InitBuckets(numBuckets * IncreaseSizeBy);
+    InitSlots(numSlots * IncreaseSizeBy);
 
     for (int i = 0; i < oldSize; i++) {
-	while (!oldTable[i]->IsEmpty()) {
-	    item = oldTable[i]->RemoveFront();
-	    buckets[HashValue(getKey(item))]->Append(item);
+	if (oldSlots[i].hash != 0) {
+	    Place(oldSlots[i].hash, oldSlots[i].item);
         }
     }
-    DeleteBuckets(oldTable, oldSize);
+    delete [] oldSlots;
     SanityCheck();
 }
 
 //----------------------------------------------------------------------
-// HashTable<Key,T>::FindInBucket
-//      Find an item in a hash table bucket, from it's key
+// HashTable<Key,T>::FindSlot
+//      Find the slot holding an item, from its key.  Give up at an
+//	empty slot, or at an item closer to its home than ours would
+//	be: ours would have taken that slot.
 //
-//	"bucket" -- the list storing the item, if it's in the table 
 //	"key" -- the key uniquely identifying the item
+//	"h" -- the key's hash value
 // 
 // Returns:
-//	Whether item is found, and if found, the item.
+//	The slot, or -1 if the item isn't in the table.
 //----------------------------------------------------------------------
 
 template <class Key, class T>
-bool
-HashTable<Key,T>::FindInBucket(int bucket, 
-				Key key, T *itemPtr) const
+int
+HashTable<Key,T>::FindSlot(Key key, unsigned h) const
 {
-    ListIterator<T> iterator(buckets[bucket]);
+    int slot = HomeSlot(h);
 
-    for (; !iterator.IsDone(); iterator.Next()) {
-	if (key == getKey(iterator.Item())) { // found!
-	    *itemPtr = iterator.Item();
-	    return TRUE;
-        }
+    for (int distance = 0; slots[slot].hash != 0; distance++) {
+	if (Distance(slot) < distance) {
+	    break;
+	}
+	if (slots[slot].hash == h && key == getKey(slots[slot].item)) {
+	    return slot;		// found!
+	}
+	slot = (slot + 1) & (numSlots - 1);
     }
-    *itemPtr = NULL;
-    return FALSE;
+    return -1;
 }
 
 //----------------------------------------------------------------------
@@ -192,14 +244,21 @@ template <class Key, class T>
 bool
 HashTable<Key,T>::Find(Key key, T *itemPtr) const
 {
-    int bucket = HashValue(key);
+    int slot = FindSlot(key, HashValue(key));
     
-    return FindInBucket(bucket, key, itemPtr); 
+    if (slot < 0) {
+	*itemPtr = NULL;
+	return FALSE;
+    }
+    *itemPtr = slots[slot].item;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // HashTable<Key,T>::Remove
 //      Remove an item from the hash table. The item must be in the table.
+//	The items after it in its run, that aren't in their home slots,
+//	each move back one slot.
 // 
 // Returns:
 //	The removed item.
@@ -209,13 +268,20 @@ template <class Key, class T>
 T
 HashTable<Key,T>::Remove(Key key)
 {
-    int bucket = HashValue(key);
+    int slot = FindSlot(key, HashValue(key));
+    int next;
     T item;
-    bool found = FindInBucket(bucket, key, &item); 
 
-    ASSERT(found);	// item must be in table
+    ASSERT(slot >= 0);	// item must be in table
+    item = slots[slot].item;
 
-    buckets[bucket]->Remove(item);
+    next = (slot + 1) & (numSlots - 1);
+    while (slots[next].hash != 0 && Distance(next) > 0) {
+	slots[slot] = slots[next];
+	slot = next;
+	next = (next + 1) & (numSlots - 1);
+    }
+    slots[slot].hash = 0;
     numItems--;
 
     ASSERT(!IsInTable(key));
@@ -234,37 +300,39 @@ template <class Key,class T>
 void
 HashTable<Key,T>::Apply(void (*func)(T)) const
 {
-    for (int bucket = 0; bucket < numBuckets; bucket++) {
-        buckets[bucket]->Apply(func);
+    for (int slot = 0; slot < numSlots; slot++) {
+	if (slots[slot].hash != 0) {
+	    (*func)(slots[slot].item);
+	}
     }
 }
 
 //----------------------------------------------------------------------
-// HashTable<Key,T>::FindNextFullBucket
-//      Find the next bucket in the hash table that has any items in it.
+// HashTable<Key,T>::FindNextFullSlot
+//      Find the next slot in the hash table that has an item in it.
 //
-//	"bucket" -- where to start looking for full buckets
+//	"slot" -- where to start looking for full slots
 //----------------------------------------------------------------------
 
 template <class Key,class T>
 int
-HashTable<Key,T>::FindNextFullBucket(int bucket) const
+HashTable<Key,T>::FindNextFullSlot(int slot) const
 { 
-    for (; bucket < numBuckets; bucket++) {
-	if (!buckets[bucket]->IsEmpty()) {
+    for (; slot < numSlots; slot++) {
+	if (slots[slot].hash != 0) {
 	     break;
 	}
     }
-    return bucket;
+    return slot;
 }
 
 //----------------------------------------------------------------------
 // HashTable<Key,T>::SanityCheck
 //      Test whether this is still a legal hash table.
 //
-//	Tests: are all the buckets legal?
-//	       does the table have the right # of elements?
-//	       do all the elements hash to where they are stored?
+//	Tests: does the table have the right # of elements?
+//	       is each item's stored hash value right?
+//	       can each item be found where it is stored?
 //----------------------------------------------------------------------
 
 template <class Key, class T>
@@ -272,19 +340,17 @@ void
 HashTable<Key,T>::SanityCheck() const
 {
     int numFound = 0;
-    ListIterator<T> *iterator;
-
-    for (int i = 0; i < numBuckets; i++) {
-	buckets[i]->SanityCheck();
-	numFound += buckets[i]->NumInList();
-	iterator = new ListIterator<T>(buckets[i]);
-        for (; !iterator->IsDone(); iterator->Next()) {
-	    ASSERT(i == HashValue(getKey(iterator->Item())));
-        }
-        delete iterator;
+
+    for (int i = 0; i < numSlots; i++) {
+	if (slots[i].hash != 0) {
+	    Key key = getKey(slots[i].item);
+
+	    numFound++;
+	    ASSERT(slots[i].hash == HashValue(key));
+	    ASSERT(FindSlot(key, slots[i].hash) == i);
+	}
     }
     ASSERT(numItems == numFound);
-
 }
 
 //----------------------------------------------------------------------
@@ -332,11 +398,7 @@ template <class Key, class T>
 HashIterator<Key,T>::HashIterator(HashTable<Key,T> *tbl) 
 { 
     table = tbl;
-    bucket = table->FindNextFullBucket(0);
-    bucketIter = NULL;
-    if (bucket < table->numBuckets) {
-	bucketIter = new ListIterator<T>(table->buckets[bucket]);
-    }
+    slot = table->FindNextFullSlot(0);
 }
 
 //----------------------------------------------------------------------
@@ -348,13 +410,5 @@ template <class Key,class T>
 void
 HashIterator<Key,T>::Next() 
 { 
-    bucketIter->Next();
-    if (bucketIter->IsDone()) {
-	delete bucketIter;
-	bucketIter = NULL;
-        bucket = table->FindNextFullBucket(++bucket);
-        if (bucket < table->numBuckets) {
-	    bucketIter = new ListIterator<T>(table->buckets[bucket]);
-        }
-    }
+    slot = table->FindNextFullSlot(slot + 1);
 }
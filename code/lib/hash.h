@@ -16,8 +16,10 @@
 //		Key GetKey(T x);
 //
 //	The hash table automatically resizes itself as items are
-//	put into the table.  The implementation uses chaining
-//	to resolve hash conflicts.
+//	put into the table.  The implementation uses open addressing
+//	to resolve hash conflicts: the items are kept in one array,
+//	so neither putting an item in the table nor looking one up
+//	allocates memory or follows a pointer.
 //
 //	Allocation and deallocation of the items in the table are to 
 //	be done by the caller.
@@ -30,7 +32,7 @@
 #define HASH_H
 
 #include "copyright.h"
-#include "list.h"
+#include "debug.h"
 
 // The following class defines a "hash table" -- allowing quick
 // lookup according to the hash function defined for the items
@@ -38,6 +40,18 @@
 
 template <class Key,class T> class HashIterator;
 
+// One entry of a hash table's array: an item, and its (scrambled) hash
+// value, so that most keys that don't match can be passed over, and 
+// the table can be expanded, without calling getKey or the hash 
+// function.  A slot whose hash is 0 is empty.
+
+template <class T>
+class HashSlot {
+  public:
+    unsigned hash;		// the item's hash value, never 0
+    T item;			// the item, if the slot isn't empty
+};
+
 template <class Key, class T> 
 class HashTable {
   public:
@@ -64,28 +78,33 @@ class HashTable {
     				// is the module working?
 
   private:
-typedef List<T> *Bucket;
-
-    Bucket *buckets;		// the array of hash buckets
-    int numBuckets;		// the number of buckets
+    HashSlot<T> *slots;		// the array of items
+    int numSlots;		// its size, a power of two
+    int shift;			// how far to shift a hash value to get
+				// the slot the item belongs in
     int numItems;		// the number of items in the table
     
     Key (*getKey)(T x);		// get Key from value
     unsigned (*hash)(Key x);	// the hash function
 
-    void InitBuckets(int size);// initialize bucket array
-    void DeleteBuckets(Bucket *table, int size);
-    				// deallocate bucket array
+    void InitSlots(int size);	// initialize the slot array
 				
-    int HashValue(Key key) const;
-    				// which bucket does the key hash to?
+    unsigned HashValue(Key key) const;
+    				// the key's hash value, as stored
+    int HomeSlot(unsigned h) const { return h >> shift; }
+    				// where an item with hash h belongs
+    int Distance(int slot) const
+	{ return (slot - HomeSlot(slots[slot].hash)) & (numSlots - 1); }
+				// how far the item in a slot is from
+				// where it belongs
 
     void ReHash();		// expand the hash table
-    
-    bool FindInBucket(int bucket, Key key, T *itemPtr) const; 
-    				// find item in bucket
-    int FindNextFullBucket(int start) const;
-    				// find next full bucket starting from this one
+    void Place(unsigned h, T item);
+    				// put an item in the slot array
+    int FindSlot(Key key, unsigned h) const; 
+    				// find the slot holding an item
+    int FindNextFullSlot(int start) const;
+    				// find next full slot starting from this one
 
     friend class HashIterator<Key,T>;
 };
@@ -102,19 +121,16 @@ template <class Key,class T>
 class HashIterator {
   public:
     HashIterator(HashTable<Key,T> *table); // initialize an iterator
-    ~HashIterator() { if (bucketIter != NULL) delete bucketIter;}; 
-				// destruct an iterator
 
-    bool IsDone() { return (bucket == table->numBuckets); };
+    bool IsDone() { return (slot == table->numSlots); };
 				// return TRUE if no more items in table 
-    T Item() { ASSERT(!IsDone()); return bucketIter->Item(); }; 
+    T Item() { ASSERT(!IsDone()); return table->slots[slot].item; }; 
 				// return current item in table
     void Next(); 		// update iterator to point to next
 
   private:   
     HashTable<Key,T> *table;	// the hash table we're stepping through
-    int bucket;			// current bucket we are in
-    ListIterator<T> *bucketIter; // where we are in the bucket
+    int slot;			// the slot of the current item
 };
 
 #include "hash.cc"		// templates are really like macros
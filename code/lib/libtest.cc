@@ -53,15 +53,171 @@ HashKey(char *str) {
 // Array of values to be inserted into a List or SortedList. 
 static int listTestVector[] = { 9, 5, 7 };
 
+//----------------------------------------------------------------------
+// ListTestItem
+//	An object that carries its own ListElement, for testing lists of
+//	objects that do (list.h).  ListTestCompare serves as the 
+//	comparison function for putting them on SortedLists.
+//----------------------------------------------------------------------
+
+class ListTestItem : public ListEmbedded<ListTestItem> {
+  public:
+    ListTestItem(int k) { key = k; }
+    int key;
+};
+
+template <> class ListElementSource<ListTestItem *>
+		: public EmbeddedListElements<ListTestItem> {};
+
+static int 
+ListTestCompare(ListTestItem *x, ListTestItem *y) {
+    return IntCompare(x->key, y->key);
+}
+
 // Array of values to be inserted into the HashTable
 // There are enough here to force a ReHash().
 static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
 	 "7", "8", "9", "10", "11", "12", "13", "14"};
 
+//----------------------------------------------------------------------
+// HashBenchmark
+//	Time hash table operations, on keys that are consecutive
+//	integers, and on keys that are far apart, like the addresses of
+//	pages: these hash to values whose low bits are all the same.
+//----------------------------------------------------------------------
+
+static const int BenchHashItems = 4000;	// items put in the table
+static const int BenchHashFinds = 10;	// times each one is looked up
+
+static int
+HashBenchKey(int *item) {
+    return *item;
+}
+
+static void
+HashBenchmark(char *what, int stride)
+{
+    HashTable<int, int *> *table = 
+	new HashTable<int, int *>(HashBenchKey, HashInt);
+    int *items = new int[BenchHashItems];
+    int *found;
+    double start, insert, find, miss, remove;
+
+    for (int i = 0; i < BenchHashItems; i++) {
+	items[i] = i * stride;
+    }
+    start = HostTime();
+    for (int i = 0; i < BenchHashItems; i++) {
+	table->Insert(&items[i]);
+    }
+    insert = HostTime() - start;
+
+    start = HostTime();
+    for (int n = 0; n < BenchHashFinds; n++) {
+	for (int i = 0; i < BenchHashItems; i++) {
+	    ASSERT(table->Find(items[i], &found) && found == &items[i]);
+	}
+    }
+    find = HostTime() - start;
+
+    start = HostTime();
+    for (int i = 0; i < BenchHashItems; i++) {
+	ASSERT(!table->Find(-1 - items[i], &found));
+    }
+    miss = HostTime() - start;
+
+    start = HostTime();
+    for (int i = 0; i < BenchHashItems; i++) {
+	(void) table->Remove(items[i]);
+    }
+    remove = HostTime() - start;
+
+    cout << "Hash table benchmark: " << BenchHashItems << " " << what 
+	 << " keys, " << (insert * 1e9) / BenchHashItems << " ns per insert, "
+	 << (find * 1e9) / (BenchHashItems * BenchHashFinds)
+	 << " ns per find, " << (miss * 1e9) / BenchHashItems
+	 << " ns per failed find, " << (remove * 1e9) / BenchHashItems
+	 << " ns per remove\n";
+    delete table;
+    delete [] items;
+}
+
+//----------------------------------------------------------------------
+// ListBenchmark
+//	Time lists used the way the kernel uses them: as a FIFO queue
+//	(synchronized lists, device request queues), and as a sorted
+//	list that the front keeps being taken off, to be put back later
+//	on (pending interrupts).  Every operation puts an item on a list,
+//	and takes one off.
+//----------------------------------------------------------------------
+
+static const int BenchListItems = 8;	// items on the list at once
+static const int BenchListRounds = 1000000; // times one is taken off
+					// and put back on
+
+static void
+ListBenchmark()
+{
+    List<int> *queue = new List<int>;
+    SortedList<int> *sorted = new SortedList<int>(IntCompare);
+    SortedList<ListTestItem *> *embedded = 
+	new SortedList<ListTestItem *>(ListTestCompare);
+    ListTestItem *items[BenchListItems];
+    ListTestItem *item;
+    double start, fifo, sort, embed;
+    int i;
+
+    for (i = 0; i < BenchListItems; i++) {
+	queue->Append(i);
+	sorted->Insert(i);
+	items[i] = new ListTestItem(i);
+	embedded->Insert(items[i]);
+    }
+
+    start = HostTime();
+    for (i = BenchListItems; i < BenchListRounds + BenchListItems; i++) {
+	(void) queue->RemoveFront();
+	queue->Append(i);
+    }
+    fifo = HostTime() - start;
+
+    start = HostTime();
+    for (i = BenchListItems; i < BenchListRounds + BenchListItems; i++) {
+	sorted->Insert(sorted->RemoveFront() + BenchListItems);
+    }
+    sort = HostTime() - start;
+
+    start = HostTime();
+    for (i = 0; i < BenchListRounds; i++) {
+	item = embedded->RemoveFront();
+	item->key += BenchListItems;
+	embedded->Insert(item);
+    }
+    embed = HostTime() - start;
+
+    cout << "List benchmark: " << BenchListItems << " items, " 
+	 << (fifo * 1e9) / BenchListRounds << " ns per queue round, "
+	 << (sort * 1e9) / BenchListRounds << " ns per sorted round, "
+	 << (embed * 1e9) / BenchListRounds 
+	 << " ns per sorted round with embedded elements\n";
+
+    while (!queue->IsEmpty()) {
+	(void) queue->RemoveFront();
+	(void) sorted->RemoveFront();
+	(void) embedded->RemoveFront();
+    }
+    for (i = 0; i < BenchListItems; i++) {
+	delete items[i];
+    }
+    delete queue;
+    delete sorted;
+    delete embedded;
+}
+
 //----------------------------------------------------------------------
 // LibSelfTest
 //	Run self tests on bitmaps, lists, sorted lists, and 
-//	hash tables.
+//	hash tables, and time the hash tables and lists.
 //----------------------------------------------------------------------
 
 void
@@ -69,17 +225,47 @@ LibSelfTest () {
     Bitmap *map = new Bitmap(200);
     List<int> *list = new List<int>;
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
+    SortedList<ListTestItem *> *itemList = 
+	new SortedList<ListTestItem *>(ListTestCompare);
+    const int numItems = sizeof(listTestVector)/sizeof(int);
+    ListTestItem *items[numItems];
     HashTable<int, char *> *hashTable = 
 	new HashTable<int, char *>(HashKey, HashInt);
+    int i;
 	
+    for (i = 0; i < numItems; i++) {
+	items[i] = new ListTestItem(listTestVector[i]);
+    }
 		
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
+    itemList->SelfTest(items, numItems);
+    itemList->Insert(items[0]);		// using its own element?
+    ASSERT(items[0]->IsOnList());
+    (void) itemList->RemoveFront();
+    for (i = 0; i < numItems; i++) {	// all back off the list?
+	ASSERT(!items[i]->IsOnList());
+	delete items[i];
+    }
+
+    // more than one slab of list elements, to use the pool's free list
+    for (i = 0; i < 1000; i++) {
+	list->Append(i);
+    }
+    for (i = 0; i < 1000; i++) {
+	ASSERT(list->RemoveFront() == i);
+    }
+    list->SanityCheck();
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector)/sizeof(char *));
 
     delete map;
     delete list;
     delete sortList;
+    delete itemList;
     delete hashTable;
+
+    HashBenchmark("consecutive", 1);
+    HashBenchmark("page-aligned", 4096);
+    ListBenchmark();
 }
@@ -6,7 +6,10 @@
 // 	A "ListElement" is allocated for each item to be put on the
 //	list; it is de-allocated when the item is removed. This means
 //      we don't need to keep a "next" pointer in every object we
-//      want to put on a list.
+//      want to put on a list.  The elements come from a pool, a
+//	slab of them at a time, so that this is cheap; objects that 
+//	are put on lists all the time can embed their own element 
+//	instead (see list.h).
 // 
 //     	NOTE: Mutual exclusion must be provided by the caller.
 //  	If you want a synchronized list, you must use the routines 
@@ -18,6 +21,9 @@
 
 #include "copyright.h"
 
+const int ListSlabSize = 64;	// how many list elements to allocate 
+				// at a time, when the pool is empty
+
 //----------------------------------------------------------------------
 // ListElement<T>::ListElement
 // 	Initialize a list element, so it can be added somewhere on a list.
@@ -32,6 +38,107 @@ ListElement<T>::ListElement(T itm)
      next = NULL;	// always initialize to something!
 }
 
+//----------------------------------------------------------------------
+// ListElement<T>::operator new, ListElement<T>::operator delete
+// 	Allocate and de-allocate list elements.  Free elements are kept
+//	on a list of their own, linked through "next", one list for 
+//	each type of element.  When it is empty, we allocate a slab of
+//	elements at once.  The storage is never given back, but it is 
+//	reused by later lists of the same type.
+//
+//	"size" -- the size of a list element
+//	"ptr" -- the element to de-allocate
+//----------------------------------------------------------------------
+
+template <class T>
+ListElement<T> *ListElement<T>::freeElements = NULL;
+
+template <class T>
+void *
+ListElement<T>::operator new(size_t size)
+{
+    ListElement<T> *element;
+
+    ASSERT(size == sizeof(ListElement<T>));
+    if (freeElements == NULL) {
+	element = (ListElement<T> *) 
+			::operator new(ListSlabSize * sizeof(ListElement<T>));
+	for (int i = 0; i < ListSlabSize; i++) {
+	    element[i].next = freeElements;
+	    freeElements = &element[i];
+	}
+    }
+    element = freeElements;
+    freeElements = element->next;
+    return element;
+}
+
+template <class T>
+void
+ListElement<T>::operator delete(void *ptr)
+{
+    ListElement<T> *element = (ListElement<T> *) ptr;
+
+    element->next = freeElements;
+    freeElements = element;
+}
+
+//----------------------------------------------------------------------
+// ListElementSource<T>::New, ListElementSource<T>::Delete
+// 	Get a list element to keep track of an item, and give it back
+//	once the item has been taken off the list.  Types whose objects
+//	carry their own element use EmbeddedListElements instead; see 
+//	list.h.
+//
+//	"item" is the thing to be put on the list.
+//	"element" is the element it was on.
+//----------------------------------------------------------------------
+
+template <class T>
+ListElement<T> *
+ListElementSource<T>::New(T item)
+{
+    return new ListElement<T>(item);
+}
+
+template <class T>
+void
+ListElementSource<T>::Delete(ListElement<T> *element)
+{
+    delete element;
+}
+
+//----------------------------------------------------------------------
+// EmbeddedListElements<C>::New, EmbeddedListElements<C>::Delete
+// 	Put an object on a list using the ListElement inside it, rather
+//	than allocating one, and take it back off.  The element's item 
+//	is NULL while it is not on a list, so the object can be on only 
+//	one.
+//
+//	"item" is the object to be put on the list.
+//	"element" is the element it was on.
+//----------------------------------------------------------------------
+
+template <class C>
+ListElement<C *> *
+EmbeddedListElements<C>::New(C *item)
+{
+    ListElement<C *> *element = &((ListEmbedded<C> *) item)->listElement;
+
+    ASSERT(element->item == NULL);
+    element->item = item;
+    element->next = NULL;
+    return element;
+}
+
+template <class C>
+void
+EmbeddedListElements<C>::Delete(ListElement<C *> *element)
+{
+    ASSERT(element->item != NULL);
+    element->item = NULL;
+}
+
 
 //----------------------------------------------------------------------
 // List<T>::List
@@ -63,7 +170,7 @@ List<T>::~List()
 // List<T>::Append
 //      Append an "item" to the end of the list.
 //      
-//	Allocate a ListElement to keep track of the item.
+//	Get a ListElement to keep track of the item.
 //      If the list is empty, then this will be the only element.
 //	Otherwise, put it at the end.
 //
@@ -74,7 +181,7 @@ template <class T>
 void
 List<T>::Append(T item)
 {
-    ListElement<T> *element = new ListElement<T>(item);
+    ListElement<T> *element = ListElementSource<T>::New(item);
 
     ASSERT(!IsInList(item));
     if (IsEmpty()) {		// list is empty
@@ -97,7 +204,7 @@ template <class T>
 void
 List<T>::Prepend(T item)
 {
-    ListElement<T> *element = new ListElement<T>(item);
+    ListElement<T> *element = ListElementSource<T>::New(item);
 
     ASSERT(!IsInList(item));
     if (IsEmpty()) {		// list is empty
@@ -137,7 +244,7 @@ List<T>::RemoveFront()
         first = element->next;
     }
     numInList--;
-    delete element;
+    ListElementSource<T>::Delete(element);
     return thing;
 }
 
@@ -167,7 +274,7 @@ List<T>::Remove(T item)
 		if (prev->next == NULL) {
 		    last = prev;
 		}
-		delete ptr;
+		ListElementSource<T>::Delete(ptr);
 		numInList--;
 		break;
 	    }
@@ -221,7 +328,7 @@ List<T>::Apply(void (*func)(T)) const
 //      Insert an "item" into a list, so that the list elements are
 //	sorted in increasing order.
 //      
-//	Allocate a ListElement to keep track of the item.
+//	Get a ListElement to keep track of the item.
 //      If the list is empty, then this will be the only element.
 //	Otherwise, walk through the list, one element at a time,
 //	to find where the new item should be placed.
@@ -233,10 +340,10 @@ template <class T>
 void
 SortedList<T>::Insert(T item)
 {
-    ListElement<T> *element = new ListElement<T>(item);
+    ListElement<T> *element = ListElementSource<T>::New(item);
     ListElement<T> *ptr;		// keep track
 
-    ASSERT(!IsInList(item));
+    ASSERT(!this->IsInList(item));
     if (this->IsEmpty()) {			// if list is empty, put at front
         this->first = element;
         this->last = element;
@@ -256,7 +363,7 @@ SortedList<T>::Insert(T item)
 	this->last = element;
     }
     this->numInList++;
-    ASSERT(IsInList(item));
+    ASSERT(this->IsInList(item));
 }
 
 //----------------------------------------------------------------------
@@ -362,14 +469,14 @@ SortedList<T>::SelfTest(T *p, int numEntries)
 
     for (i = 0; i < numEntries; i++) {
 	 Insert(p[i]);
-	 ASSERT(IsInList(p[i]));
+	 ASSERT(this->IsInList(p[i]));
      }
      SanityCheck();
 
      // should be able to get out everything we put in
      for (i = 0; i < numEntries; i++) {
 	 q[i] = this->RemoveFront();
-         ASSERT(!IsInList(q[i]));
+         ASSERT(!this->IsInList(q[i]));
      }
      ASSERT(this->IsEmpty());
 
@@ -379,5 +486,5 @@ SortedList<T>::SelfTest(T *p, int numEntries)
      }
      SanityCheck();
 
-     delete q;
+     delete [] q;
 }
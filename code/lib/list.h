@@ -30,6 +30,58 @@ class ListElement {
     ListElement(T itm); 	// initialize a list element
     ListElement *next;	     	// next element on list, NULL if this is last
     T item; 	   	     	// item on the list
+
+    void *operator new(size_t size);	// allocate an element, from 
+    void operator delete(void *ptr);	// a pool for elements of this type
+
+  private:
+    static ListElement<T> *freeElements; // elements not in use
+};
+
+// The following class says where a list of T's gets the ListElement
+// for an item, and gives it back once the item is off the list.  By
+// default, it allocates a new element from the pool, and de-allocates
+// it.
+
+template <class T>
+class ListElementSource {
+  public:
+    static ListElement<T> *New(T item);	// an element for "item"
+    static void Delete(ListElement<T> *element);
+				// give back "element"
+};
+
+// An object that is only ever on one list at a time can instead
+// carry its own ListElement, so that putting it on a list allocates
+// nothing; pending interrupts and mail do this.  Its class derives
+// from ListEmbedded, and says so to lists just after the class:
+//
+//	class Foo : public ListEmbedded<Foo> { ... };
+//	template <> class ListElementSource<Foo *> 
+//			: public EmbeddedListElements<Foo> {};
+
+template <class C> class EmbeddedListElements;
+
+template <class C>
+class ListEmbedded {
+  public:
+    ListEmbedded() : listElement(NULL) {}
+    bool IsOnList() { return listElement.item != NULL; }
+				// is this object on a list now?
+
+  private:
+    ListElement<C *> listElement; // keeps track of us on our list; the
+				// item is NULL while we aren't on one
+
+    friend class EmbeddedListElements<C>;
+};
+
+template <class C>
+class EmbeddedListElements {
+  public:
+    static ListElement<C *> *New(C *item);	// the element in "item"
+    static void Delete(ListElement<C *> *element);
+				// mark it as not on a list
 };
 
 // The following class defines a "list" -- a singly linked list of
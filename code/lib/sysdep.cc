@@ -40,6 +40,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef LINUX
+#include <sys/epoll.h>
+#endif
+
 #ifdef LINUX	 // at this point, linux doesn't support mprotect 
 #define NO_MPROT     
 #endif
@@ -149,6 +153,21 @@ UDelay(unsigned int useconds)
 
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the wall clock time of the host, in seconds.  Used to
+//	measure how fast Nachos itself runs, as opposed to simulated time.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -537,30 +556,59 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
 //    modified by KMS to add retry...
 // SendToSocket
 // 	Transmit a fixed size packet to another Nachos' IPC port.
-//	Try 10 times with a one second delay between attempts.
+//	Keep trying for 10 seconds, every SocketRetryWait microseconds.
 //      This is useful, e.g., to give the other socket a chance
-//      to get set up.
-//      Terminate if we still fail after 10 tries.
+//      to get set up; retrying often means a machine started a moment
+//	after this one costs us a moment, not a whole second.
+//      Terminate if we still fail after 10 seconds.
+//
+//	If the other Nachos has too many packets waiting already, wait
+//	for it to take some in.  Or, after DropWhenSocketFull(TRUE), give
+//	it up to SocketFullWait microseconds, and then drop the packet,
+//	as a real network would, and count it (see NumSocketDrops).
+//	Waiting for as long as it takes could deadlock two Nachos that
+//	are flooding each other; dropping makes even a reliable network
+//	lossy.
 //----------------------------------------------------------------------
+
+static const int SocketRetryWait = 10000;
+static const int SocketRetries = 1000;
+static const int SocketFullWait = 10000;
+
+static bool dropWhenFull = FALSE;	// give up on a full socket?
+static int socketDrops = 0;		// packets given up on
+
 void
 SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
 {
     struct sockaddr_un uName;
     int retVal;
     int retryCount;
+    int fullWait = 0;
 
     InitSocketName(&uName, toName);
 
-    for(retryCount=0;retryCount < 10;retryCount++) {
-      retVal = sendto(sockID, buffer, packetSize, 0, 
+    for(retryCount=0;retryCount < SocketRetries;) {
+      retVal = sendto(sockID, buffer, packetSize, 
+			dropWhenFull ? MSG_DONTWAIT : 0,
 			(struct sockaddr *) &uName, sizeof(uName));
       if (retVal == packetSize) return;
       // if we did not succeed, we should see a negative
       // return value indicating complete failure.  If we
       // don't, something fishy is going on...
       ASSERT(retVal < 0);
-      // wait a second before trying again
-      Delay(1);
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	if (fullWait >= SocketFullWait) {	// drop it
+	    socketDrops++;
+	    return;
+	}
+	UDelay(100);
+	fullWait += 100;
+	continue;
+      }
+      // wait a bit before trying again
+      UDelay(SocketRetryWait);
+      retryCount++;
     }
     // At this point, we have failed many times
     // The most common reason for this is that the target machine
@@ -569,3 +617,108 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
     // This may mask other kinds of failures, but it is the
     // right thing to do in the common case.
 }
+
+//----------------------------------------------------------------------
+// DropWhenSocketFull
+// 	Choose whether SendToSocket drops a packet that the other Nachos
+//	has no room for, rather than waiting; by default it waits.
+//
+// NumSocketDrops
+// 	How many packets SendToSocket has dropped that way.
+//----------------------------------------------------------------------
+
+void
+DropWhenSocketFull(bool drop)
+{
+    dropWhenFull = drop;
+}
+
+int
+NumSocketDrops()
+{
+    return socketDrops;
+}
+
+//----------------------------------------------------------------------
+// OpenWaitSet
+// 	Create an empty set of files to wait on, and return its ID, or 
+//	-1 if we can't wait on a set.  On Linux, this is an epoll 
+//	instance, so the set is handed to the kernel once, rather than 
+//	on every wait.  An epoll instance can itself be polled, and is
+//	ready when anything in it is, which lets us wait on it for less
+//	than the millisecond epoll_wait counts in.
+//----------------------------------------------------------------------
+
+int
+OpenWaitSet()
+{
+#ifdef LINUX
+    int setID = epoll_create(1);
+
+    ASSERT(setID >= 0);
+    return setID;
+#else
+    return -1;
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddToWaitSet
+// 	Wait for input on "fd", as well as whatever else is in the set.
+//	It stays in the set until it is closed.
+//----------------------------------------------------------------------
+
+void
+AddToWaitSet(int setID, int fd)
+{
+#ifdef LINUX
+    struct epoll_event event;
+    int retVal;
+
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    retVal = epoll_ctl(setID, EPOLL_CTL_ADD, fd, &event);
+    ASSERT(retVal == 0);
+#endif
+}
+
+//----------------------------------------------------------------------
+// WaitOnSet
+// 	Wait until a file in the set has input, or "usec" microseconds 
+//	have passed (forever, if "usec" is negative).  Return TRUE if 
+//	there is input.
+//----------------------------------------------------------------------
+
+bool
+WaitOnSet(int setID, int usec)
+{
+#ifdef LINUX
+    fd_set rfd;
+    struct timeval waitTime;
+    int retVal;
+
+    FD_ZERO(&rfd);
+    FD_SET(setID, &rfd);
+    waitTime.tv_sec = usec / 1000000;
+    waitTime.tv_usec = usec % 1000000;
+    retVal = select(setID + 1, &rfd, NULL, NULL, 
+					(usec < 0) ? NULL : &waitTime);
+    ASSERT(retVal >= 0 || errno == EINTR);
+    return retVal > 0;
+#else
+    return FALSE;
+#endif
+}
+
+//----------------------------------------------------------------------
+// CloseWaitSet
+// 	De-allocate a wait set.
+//----------------------------------------------------------------------
+
+void
+CloseWaitSet(int setID)
+{
+#ifdef LINUX
+    (void) close(setID);
+#endif
+}
@@ -25,6 +25,9 @@ extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);// rcgood - to avoid spinners.
 
+// Host wall clock time in seconds, for measuring Nachos performance
+extern double HostTime();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
@@ -71,5 +74,15 @@ extern void DeAssignNameToSocket(char *socketName);
 extern bool PollSocket(int sockID);
 extern void ReadFromSocket(int sockID, char *buffer, int packetSize);
 extern void SendToSocket(int sockID, char *buffer, int packetSize,char *toName);
+extern void DropWhenSocketFull(bool drop);
+extern int NumSocketDrops();
+
+// Wait sets: block until one of several files or sockets has input,
+// for letting an idle machine sleep.  OpenWaitSet returns -1 where
+// this isn't supported.
+extern int OpenWaitSet();
+extern void AddToWaitSet(int setID, int fd);
+extern bool WaitOnSet(int setID, int usec);
+extern void CloseWaitSet(int setID);
 
 #endif // SYSDEP_H
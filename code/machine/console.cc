@@ -19,9 +19,10 @@
 //----------------------------------------------------------------------
 // ConsoleInput::ConsoleInput
 // 	Initialize the simulation of the input for a hardware console device.
+//	No interrupts happen until someone asks for input with Arm().
 //
 //	"readFile" -- UNIX file simulating the keyboard (NULL -> use stdin)
-// 	"toCall" is the interrupt handler to call when a character arrives
+// 	"toCall" is the interrupt handler to call when characters arrive
 //		from the keyboard
 //----------------------------------------------------------------------
 
@@ -34,11 +35,9 @@ ConsoleInput::ConsoleInput(char *readFile, CallBackObj *toCall)
 
     // set up the stuff to emulate asynchronous interrupts
     callWhenAvail = toCall;
-    incoming = EOF;
-	disabled = false; // 2015.11.25
-
-    // start polling for incoming keystrokes
-    kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
+    armed = FALSE;
+    first = last = 0;
+    atEOF = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -52,51 +51,63 @@ ConsoleInput::~ConsoleInput()
 	Close(readFileNo);
 }
 
+//----------------------------------------------------------------------
+// ConsoleInput::Arm()
+// 	Start polling for incoming keystrokes, because someone wants
+//	to read some.  "callWhenAvail" will be called once there are
+//	characters to be gotten, or the input has run out.  While 
+//	nobody is waiting, the keyboard doesn't interrupt, so the 
+//	machine can go idle.
+//----------------------------------------------------------------------
+
+void
+ConsoleInput::Arm()
+{
+    if (!armed) {
+	armed = TRUE;
+	kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
+    }
+}
 
 //----------------------------------------------------------------------
 // ConsoleInput::CallBack()
-// 	Simulator calls this when a character may be available to be
+// 	Simulator calls this when characters may be available to be
 //	read in from the simulated keyboard (eg, the user typed something).
 //
-//	First check to make sure character is available.
-//	Then invoke the "callBack" registered by whoever wants the character.
+//	First check to make sure characters are available, and if so, 
+//	take in as many as will fit in the buffer.  Then invoke the 
+//	"callBack" registered by whoever wants them.
 //----------------------------------------------------------------------
 
 void
 ConsoleInput::CallBack()
 {
-  char c;
-  int readCount;
-
-    ASSERT(incoming == EOF);
-	// 2015.11.25
-	// do not schedule any more interrupts if console is disabled
-	if (disabled) {
-		return;
-	}
-	
+    int readCount;
+
+    ASSERT(armed);
+    if (IsAvailable()) {		// nothing new needed
+	armed = FALSE;
+	callWhenAvail->CallBack();
+	return;
+    }
     if (!PollFile(readFileNo)) { // nothing to be read
-        // schedule the next time to poll for a packet
+        // schedule the next time to poll for input
         kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
-    } else { 
-    	// otherwise, try to read a character
-    	readCount = ReadPartial(readFileNo, &c, sizeof(char));
-	if (readCount == 0) {
-	   // this seems to happen at end of file, when the
-	   // console input is a regular file
-	   // don't schedule an interrupt, since there will never
-	   // be any more input
-	   // just do nothing....
-	}
-	else {
-	  // save the character and notify the OS that
-	  // it is available
-	  ASSERT(readCount == sizeof(char));
-	  incoming = c;
-	  kernel->stats->numConsoleCharsRead++;
-	}
-	callWhenAvail->CallBack();
+	return;
+    }
+    readCount = ReadPartial(readFileNo, incoming, ConsoleBufferSize);
+    if (readCount <= 0) {
+	// this seems to happen at end of file, when the
+	// console input is a regular file; there will never
+	// be any more input
+	atEOF = TRUE;
+    } else {
+	first = 0;
+	last = readCount;
+	kernel->stats->numConsoleCharsRead += readCount;
     }
+    armed = FALSE;
+    callWhenAvail->CallBack();
 }
 
 //----------------------------------------------------------------------
@@ -108,17 +119,12 @@ ConsoleInput::CallBack()
 char
 ConsoleInput::GetChar()
 {
-   char ch = incoming;
-
-   if (incoming != EOF) {	// schedule when next char will arrive
-       kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
-   }
-   incoming = EOF;
-   return ch;
+    if (first == last) {
+	return EOF;
+    }
+    return incoming[first++];
 }
 
-
-
 //----------------------------------------------------------------------
 // ConsoleOutput::ConsoleOutput
 // 	Initialize the simulation of the output for a hardware console device.
@@ -137,6 +143,7 @@ ConsoleOutput::ConsoleOutput(char *writeFile, CallBackObj *toCall)
 
     callWhenDone = toCall;
     putBusy = FALSE;
+    putSize = 0;
 }
 
 //----------------------------------------------------------------------
@@ -152,15 +159,15 @@ ConsoleOutput::~ConsoleOutput()
 
 //----------------------------------------------------------------------
 // ConsoleOutput::CallBack()
-// 	Simulator calls this when the next character can be output to the
-//	display.
+// 	Simulator calls this when the next character (or string) can be
+//	output to the display.
 //----------------------------------------------------------------------
 
 void
 ConsoleOutput::CallBack()
 {
     putBusy = FALSE;
-    kernel->stats->numConsoleCharsWritten++;
+    kernel->stats->numConsoleCharsWritten += putSize;
     callWhenDone->CallBack();
 }
 
@@ -172,10 +179,28 @@ ConsoleOutput::CallBack()
 
 void
 ConsoleOutput::PutChar(char ch)
+{
+    PutString(&ch, 1);
+}
+
+//----------------------------------------------------------------------
+// ConsoleOutput::PutString()
+// 	Write a string of characters to the simulated display, with one
+//	write to the host, and schedule a single interrupt for when they
+//	have all been displayed.
+//
+//	"buffer" -- the characters to write
+//	"size" -- how many there are, 1 .. ConsoleBufferSize
+//----------------------------------------------------------------------
+
+void
+ConsoleOutput::PutString(char *buffer, int size)
 {
     ASSERT(putBusy == FALSE);
-    WriteFile(writeFileNo, &ch, sizeof(char));
+    ASSERT(size > 0 && size <= ConsoleBufferSize);
+    WriteFile(writeFileNo, buffer, size);
     putBusy = TRUE;
-    kernel->interrupt->Schedule(this, ConsoleTime, ConsoleWriteInt);
+    putSize = size;
+    kernel->interrupt->Schedule(this, ConsoleTime * size, ConsoleWriteInt);
 }
 
@@ -36,13 +36,24 @@
 // by reading (and writing) to the UNIX file "readFile" (and "writeFile").
 //
 // Since input (and output) to the device is asynchronous, the interrupt 
-// handler "callWhenAvail" is called when a character has arrived to be 
-// read in (and "callWhenDone" is called when an output character has been 
-// "put" so that the next character can be written).
+// handler "callWhenAvail" is called when characters have arrived to be 
+// read in (and "callWhenDone" is called when output characters have been 
+// "put" so that the next ones can be written).
 //
 // In practice, usually a single hardware thing that does both
 // serial input and serial output.  But conceptually simpler to
 // use two objects.
+//
+// The display has a buffer, so a whole string of up to ConsoleBufferSize
+// characters can be written at once.  It still takes ConsoleTime per
+// character to display, but there is only one interrupt, when the whole
+// string has been put out.
+//
+// The keyboard has a buffer too.  It only interrupts when asked to,
+// by Arm(), and then takes in whatever has been typed, up to a buffer
+// full, with a single interrupt.
+
+const int ConsoleBufferSize = 256;	// most characters moved at once
 
 class ConsoleInput : public CallBackObj {
   public:
@@ -50,25 +61,25 @@ class ConsoleInput : public CallBackObj {
 				// initialize hardware console input 
     ~ConsoleInput();		// clean up console emulation
 
+    void Arm();			// Ask for "callWhenAvail" to be called
+    				// once input is available.  Until then,
+				// the device doesn't interrupt at all.
+    bool IsAvailable() { return first < last || atEOF; }
+    				// Is there a char (or EOF) to be gotten?
     char GetChar();	   	// Poll the console input.  If a char is 
 				// available, return it.  Otherwise, return EOF.
-    				// "callWhenAvail" is called whenever there is 
-				// a char to be gotten
 
-    void CallBack();		// Invoked when a character arrives
+    void CallBack();		// Invoked when characters may have arrived
 				// from the keyboard.
-				
-	void Disable() { disabled = true; } // 2015.11.25
 
   private:
     int readFileNo;			// UNIX file emulating the keyboard 
     CallBackObj *callWhenAvail;		// Interrupt handler to call when 
 					// there is a char to be read
-    char incoming;    			// Contains the character to be read,
-					// if there is one available. 
-					// Otherwise contains EOF.
-	//2015.11.25
-	bool disabled;
+    bool armed;				// is someone waiting for input?
+    char incoming[ConsoleBufferSize];	// characters read in, but not
+    int first, last;			// yet gotten, are incoming[first..last-1]
+    bool atEOF;				// has the input run out?
 };
 
 class ConsoleOutput : public CallBackObj {
@@ -80,6 +91,9 @@ class ConsoleOutput : public CallBackObj {
     void PutChar(char ch);	// Write "ch" to the console display, 
 				// and return immediately.  "callWhenDone" 
 				// will called when the I/O completes. 
+    void PutString(char *buffer, int size);
+    				// Same, for "size" characters, at most
+				// ConsoleBufferSize of them
     void CallBack();		// Invoked when next character can be put
 				// out to the display.
 
@@ -89,6 +103,7 @@ class ConsoleOutput : public CallBackObj {
 					// the next char can be put 
     bool putBusy;    			// Is a PutChar operation in progress?
 					// If so, you can't do another one!
+    int putSize;			// how many characters it is writing
 };
 
 #endif // CONSOLE_H
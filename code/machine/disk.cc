@@ -35,9 +35,11 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 // 	ok to treat it as Nachos disk storage.
 //
 //	"toCall" -- object to call when disk read/write request completes
+//	"unit" -- which of this machine's disks, if it has several, or -1
+//		for its only one; each is its own UNIX file
 //----------------------------------------------------------------------
 
-Disk::Disk(CallBackObj *toCall)
+Disk::Disk(CallBackObj *toCall, int unit)
 {
     int magicNum;
     int tmp = 0;
@@ -47,7 +49,11 @@ Disk::Disk(CallBackObj *toCall)
     lastSector = 0;
     bufferInit = 0;
 
-    sprintf(diskname,"DISK_%d",kernel->hostName);
+    if (unit < 0) {
+	sprintf(diskname,"DISK_%d",kernel->hostName);
+    } else {
+	sprintf(diskname,"DISK_%d_%d",kernel->hostName,unit);
+    }
     fileno = OpenForReadWrite(diskname, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number
 	Read(fileno, (char *) &magicNum, MagicSize);
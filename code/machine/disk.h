@@ -55,9 +55,12 @@ const int NumSectors = (SectorsPerTrack * NumTracks);
 
 class Disk : public CallBackObj {
   public:
-    Disk(CallBackObj *toCall);          // Create a simulated disk.  
+    Disk(CallBackObj *toCall, int unit = -1);
+					// Create a simulated disk.  
 					// Invoke toCall->CallBack() 
 					// when each request completes.
+					// A machine with several disks
+					// numbers them from 0, as "unit"
     ~Disk();				// Deallocate the disk.
     
     void ReadRequest(int sectorNumber, char* data);
@@ -76,6 +76,8 @@ Interrupt::Interrupt()
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    waitSet = -1;
+    pollers = new List<CallBackObj *>;
 }
 
 //----------------------------------------------------------------------
@@ -89,6 +91,10 @@ Interrupt::~Interrupt()
 	delete pending->RemoveFront();
     }
     delete pending;
+    if (waitSet >= 0) {
+	CloseWaitSet(waitSet);
+    }
+    delete pollers;
 }
 
 //----------------------------------------------------------------------
@@ -171,6 +177,9 @@ Interrupt::OneTick()
 	yieldOnReturn = FALSE;
  	status = SystemMode;		// yield is a kernel routine
 	kernel->currentThread->Yield();
+	if (oldStatus == UserMode) {	// going back to user code
+	    ReturnToUser();
+	}
 	status = oldStatus;
     }
 }
@@ -209,6 +218,7 @@ Interrupt::Idle()
 {
     DEBUG(dbgInt, "Machine idling; checking for interrupts.");
     status = IdleMode;
+    WaitForInput();
     if (CheckIfDue(TRUE)) {	// check for any pending interrupts
 		status = SystemMode;
 		return;			// return in case there's now
@@ -242,6 +252,8 @@ Interrupt::Halt()
     cout << "This is halt\n";
     kernel->stats->Print();
 	*/
+	kernel->scheduler->PrintStats();
+	kernel->stats->PrintMail();
 	delete debug;
 
     delete kernel;	// Never returns.
@@ -308,6 +320,82 @@ Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
     pending->Insert(toOccur);
 }
 
+//----------------------------------------------------------------------
+// Interrupt::WatchFile
+// 	Let the machine sleep, when it is idle, until there is input on 
+//	a UNIX file, rather than racing simulated time ahead to each of
+//	the device's polls in turn.  The file is watched until it is 
+//	closed.
+//
+//	"fd" -- the UNIX file
+//	"poller" -- the device that polls it, with interrupts it 
+//		schedules for itself
+//----------------------------------------------------------------------
+
+void
+Interrupt::WatchFile(int fd, CallBackObj *poller)
+{
+    if (waitSet < 0) {
+	waitSet = OpenWaitSet();
+	if (waitSet < 0) {		// can't sleep here; keep polling
+	    return;
+	}
+    }
+    AddToWaitSet(waitSet, fd);
+    pollers->Append(poller);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::WaitForInput
+// 	Called when the machine is idle.  If the next thing to happen
+//	is a poll of a watched file, sleep until one of the files has
+//	input, or until the first interrupt that isn't a poll is due.
+//	Either way, the simulated clock moves ahead by the time slept
+//	(HostUsecTicks per microsecond), and the polls that fall in 
+//	that time happen right after, in one go.  So while an idle 
+//	machine waits for input, simulated time keeps up with real time,
+//	instead of racing ahead.
+//
+//	If only polls are pending, sleep for as long as it takes.
+//----------------------------------------------------------------------
+
+void
+Interrupt::WaitForInput()
+{
+    Statistics *stats = kernel->stats;
+    ListIterator<PendingInterrupt *> iter(pending);
+    PendingInterrupt *next = NULL;	// first interrupt that isn't a poll
+    bool polling = FALSE;
+    int usec = -1;
+    int ticks;
+    double start;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (!pollers->IsInList(iter.Item()->callOnInterrupt)) {
+	    next = iter.Item();
+	    break;
+	}
+	polling = TRUE;
+    }
+    if (!polling) {			// nothing to wait for
+	return;
+    }
+    if (next != NULL) {
+	usec = (next->when - stats->totalTicks) / HostUsecTicks;
+    }
+
+    DEBUG(dbgInt, "Machine sleeping for input, for at most " << usec 
+								<< " usec");
+    start = HostTime();
+    (void) WaitOnSet(waitSet, usec);
+    ticks = (int)((HostTime() - start) * 1000000 * HostUsecTicks);
+    if (next != NULL) {
+	ticks = min(ticks, next->when - stats->totalTicks);
+    }
+    stats->idleTicks += ticks;
+    stats->totalTicks += ticks;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::CheckIfDue
 // 	Check if any interrupts are scheduled to occur, and if so,
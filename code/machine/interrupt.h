@@ -54,8 +54,12 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
+//
+// It carries the ListElement that keeps track of it on the pending
+// list (list.h), so that scheduling an interrupt only allocates the
+// PendingInterrupt.
 
-class PendingInterrupt {
+class PendingInterrupt : public ListEmbedded<PendingInterrupt> {
   public:
     PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
 				// initialize an interrupt that will
@@ -68,6 +72,9 @@ class PendingInterrupt {
     IntType type;		// for debugging
 };
 
+template <> class ListElementSource<PendingInterrupt *>
+		: public EmbeddedListElements<PendingInterrupt> {};
+
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
 // or disabled, and any hardware interrupts that are scheduled to occur
@@ -122,6 +129,11 @@ class Interrupt {
     				// Schedule an interrupt to occur
 				// at time "when".  This is called
     				// by the hardware device simulators.
+
+    void WatchFile(int fd, CallBackObj *poller);
+				// "poller" polls UNIX file "fd" for input;
+				// while the machine is idle, sleep until
+				// there is some, instead of polling
     
     void OneTick();       	// Advance simulated time
 
@@ -137,6 +149,8 @@ class Interrupt {
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    int waitSet;		// UNIX files that pollers are watching
+    List<CallBackObj *> *pollers; // devices that poll them
 
     // these functions are internal to the interrupt simulation code
 
@@ -144,6 +158,9 @@ class Interrupt {
     				// Check if any interrupts are supposed
 				// to occur now, and if so, do them
 
+    void WaitForInput();	// Sleep until a watched file has input,
+				// or the next interrupt is due
+
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 			IntStatus now); // simulated time
 };
@@ -105,6 +105,7 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     DelayedLoad(0, 0);			// finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
+    ReturnToUser();
     kernel->interrupt->setStatus(UserMode);
 }
 
@@ -185,6 +185,9 @@ extern void ExceptionHandler(ExceptionType which);
 				// Entry point into Nachos for handling
 				// user system calls and exceptions
 				// Defined in exception.cc
+extern void ReturnToUser();	// Check that the current thread can
+				// go back to running user code
+				// Defined in exception.cc
 
 
 // Routines for converting Words and Short Words to and from the
@@ -23,15 +23,16 @@ NetworkInput::NetworkInput(CallBackObj *toCall)
 {
     // set up the stuff to emulate asynchronous interrupts
     callWhenAvail = toCall;
-    packetAvail = FALSE;
-    inHdr.length = 0;
+    inFirst = inCount = 0;
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", kernel->hostName);
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
 
-    // start polling for incoming packets
+    // start polling for incoming packets, but don't poll an idle 
+    // machine; let it sleep until one comes
+    kernel->interrupt->WatchFile(sock, this);
     kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
 }
 
@@ -49,56 +50,62 @@ NetworkInput::~NetworkInput()
 
 //-----------------------------------------------------------------------
 // NetworkInput::CallBack
-//	Simulator calls this when a packet may be available to
+//	Simulator calls this when packets may be available to
 //	be read in from the simulated network.
 //
-//      First check to make sure packet is available & there's space to
-//	pull it in.  Then invoke the "callBack" registered by whoever 
-//	wants the packet.
+//      Pull in packets for as long as there are more and there's space
+//	for them, and invoke the "callBack" registered by whoever 
+//	wants the packets once for each.
 //-----------------------------------------------------------------------
 
 void
 NetworkInput::CallBack()
 {
+    char buffer[MaxWireSize];
+    PacketHeader *hdr;
+    int slot;
+
     // schedule the next time to poll for a packet
     kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
 
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
+    while (inCount < NetworkQueueSize && PollSocket(sock)) {
+	ReadFromSocket(sock, buffer, MaxWireSize);
 
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+	// divide packet into header and data
+	slot = (inFirst + inCount) % NetworkQueueSize;
+	hdr = &inHdr[slot];
+	*hdr = *(PacketHeader *)buffer;
+	ASSERT((hdr->to == kernel->hostName) && 
+					(hdr->length <= MaxPacketSize));
+	bcopy(buffer + sizeof(PacketHeader), inbox[slot], hdr->length);
+	inCount++;
 
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == kernel->hostName) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete [] buffer ;
+	DEBUG(dbgNet, "Network received packet from " << hdr->from << ", length " << hdr->length);
+	kernel->stats->numPacketsRecvd++;
 
-    DEBUG(dbgNet, "Network received packet from " << inHdr.from << ", length " << inHdr.length);
-    kernel->stats->numPacketsRecvd++;
-
-    // tell post office that the packet has arrived
-    callWhenAvail->CallBack();
+	// tell post office that the packet has arrived
+	callWhenAvail->CallBack();
+    }
 }
 
 //-----------------------------------------------------------------------
 // NetworkInput::Receive
-// 	Read a packet, if one is buffered
+// 	Read the oldest packet, if one is buffered
 //-----------------------------------------------------------------------
 
 PacketHeader
 NetworkInput::Receive(char* data)
 {
-    PacketHeader hdr = inHdr;
+    PacketHeader hdr;
 
-    inHdr.length = 0;
-    if (hdr.length != 0) {
-    	bcopy(inbox, data, hdr.length);
+    if (inCount == 0) {
+	hdr.length = 0;
+	return hdr;
     }
+    hdr = inHdr[inFirst];
+    bcopy(inbox[inFirst], data, hdr.length);
+    inFirst = (inFirst + 1) % NetworkQueueSize;
+    inCount--;
     return hdr;
 }
 
@@ -41,6 +41,8 @@ class PacketHeader {
 #define MaxWireSize 	64	// largest packet that can go out on the wire
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
+#define NetworkQueueSize 16	// packets the input device can hold until
+				// they are Received
 
 
 // The following two classes defines a physical network device.  The network
@@ -52,6 +54,11 @@ class PacketHeader {
 // a packet.  Note that you can change the seed for the random number 
 // generator, by changing the arguments to RandomInit() in Initialize().
 // The random number generator is used to choose which packets to drop.
+//
+// The input device takes in every packet that is waiting each time it
+// polls, as long as it has room, and interrupts once for each.  While 
+// the machine is idle, it sleeps until a packet arrives, rather than 
+// polling.
 
 class NetworkInput : public CallBackObj{
   public:
@@ -62,11 +69,11 @@ class NetworkInput : public CallBackObj{
     PacketHeader Receive(char* data);
     				// Poll the network for incoming messages.  
 				// If there is a packet waiting, copy the 
-				// packet into "data" and return the header.
-				// If no packet is waiting, return a header 
-				// with length 0.
+				// oldest one into "data" and return the 
+				// header.  If no packet is waiting, return 
+				// a header with length 0.
 
-    void CallBack();		// A packet may have arrived.
+    void CallBack();		// Packets may have arrived.
 
   private:
     int sock;                   // UNIX socket number for incoming packets
@@ -74,10 +81,13 @@ class NetworkInput : public CallBackObj{
 
     CallBackObj *callWhenAvail; // Interrupt handler, signalling packet has 
 				// 	arrived.
-    bool packetAvail;		// Packet has arrived, can be pulled off of
-				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+    PacketHeader inHdr[NetworkQueueSize];
+				// Information about arrived packets
+    char inbox[NetworkQueueSize][MaxPacketSize];  
+				// Data for arrived packets
+    int inFirst;		// Oldest arrived packet
+    int inCount;		// How many have arrived and not been
+				//   pulled off of the network
 };
 
 class NetworkOutput : public CallBackObj {
@@ -22,6 +22,7 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numMailSent = numMailRecvd = 0;
 }
 
 //----------------------------------------------------------------------
@@ -42,4 +43,22 @@ Statistics::Print()
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    PrintMail();
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintMail
+// 	Print how many messages went through the post office, and how
+//	fast, if any did.
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintMail()
+{
+    if (numMailSent > 0 || numMailRecvd > 0) {
+	// a tick is about a microsecond of simulated time
+	cout << "Mail: messages received " << numMailRecvd;
+	cout << ", sent " << numMailSent << ", per simulated second ";
+	cout << (numMailRecvd + numMailSent) * 1e6 / totalTicks << "\n";
+    }
 }
@@ -35,10 +35,13 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numMailSent;		// number of messages sent by the post office
+    int numMailRecvd;		// number of messages taken out of mailboxes
 
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
+    void PrintMail();		// print just the post office's
 };
 
 // Constants used to reflect the relative time an operation would
@@ -56,5 +59,7 @@ const int SeekTime =	 500;  	// time disk takes to seek past one track
 const int ConsoleTime =	 100;	// time to read or write one character
 const int NetworkTime =	 100;  	// time to send or receive one packet
 const int TimerTicks = 	 100;  	// (average) time between timer interrupts
+const int HostUsecTicks =   1;	// time that passes while an idle machine
+				// sleeps one host microsecond
 
 #endif // STATS_H
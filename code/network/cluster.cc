@@ -0,0 +1,304 @@
+// cluster.cc
+//	A program, separate from Nachos itself, that runs the cluster
+//	test: it starts several Nachos machines on this host, each with
+//	its own machine id, waits for them to finish sending each other
+//	messages (see Kernel::ClusterTest), and combines what they
+//	report into one table and one histogram of message latencies.
+//
+//	Usage: cluster nodes all|ring|fanin count [nachos flags]
+//
+//	Run it where the nachos binary is (it starts ./nachos, or
+//	$NACHOS).  The machines all run in a scratch directory made
+//	under $TMPDIR (or /tmp), which is removed afterwards: there they
+//	talk through UNIX sockets named SOCKET_<id>, as usual, each
+//	formats a fresh DISK_<id>, and each one's output goes to
+//	CLUSTER_<id> until it is collected.  So the disks in the current
+//	directory are left alone.  Any flags after the count are passed
+//	to every machine, e.g. "-n 0.9".
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+static const int ClusterTimeout = 120;	// seconds to let the machines run
+static const int LatencyBuckets = 24;	// as in Kernel::ClusterTest
+
+// What one machine reported
+
+class NodeReport {
+  public:
+    bool done;			// did it report at all?
+    int sent, received, expected;	// messages
+    int packetsSent, packetsRecvd;
+    int ticks;			// simulated time it took
+    double seconds;		// host time it took
+    int dropped;		// packets it gave up on (see SendToSocket)
+    int latency[LatencyBuckets];	// histogram, as in ClusterTest
+};
+
+//----------------------------------------------------------------------
+// StartNode
+// 	Start Nachos machine "id", with its output going to CLUSTER_<id>.
+//	Return its process id.
+//
+//	"argv" -- the Nachos command line, with room for the machine id
+//		in argv[2]
+//----------------------------------------------------------------------
+
+static pid_t
+StartNode(int id, char **argv)
+{
+    char name[32], idArg[16];
+    pid_t pid;
+    int fd;
+
+    sprintf(name, "SOCKET_%d", id);
+    (void) unlink(name);		// left over from an earlier run
+    sprintf(name, "CLUSTER_%d", id);
+    sprintf(idArg, "%d", id);
+    argv[2] = idArg;
+
+    pid = fork();
+    if (pid < 0) {
+	perror("fork");
+	exit(1);
+    }
+    if (pid == 0) {
+	fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+	    perror(name);
+	    _exit(1);
+	}
+	dup2(fd, 1);
+	dup2(fd, 2);
+	close(fd);
+	execv(argv[0], argv);
+	perror(argv[0]);
+	_exit(1);
+    }
+    return pid;
+}
+
+//----------------------------------------------------------------------
+// ReadReport
+// 	Collect what machine "id" printed, and remove its output file.
+//----------------------------------------------------------------------
+
+static void
+ReadReport(int id, NodeReport *report)
+{
+    char name[32], line[256];
+    FILE *f;
+    int usec, n, bucket;
+
+    report->done = false;
+    for (int i = 0; i < LatencyBuckets; i++) {
+	report->latency[i] = 0;
+    }
+    sprintf(name, "CLUSTER_%d", id);
+    f = fopen(name, "r");
+    if (f == NULL) {
+	return;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+	if (sscanf(line, "Cluster node %*d: messages sent %d, received %d "
+		"of %d, packets sent %d, received %d, ticks %d, host "
+		"seconds %lf, dropped %d", &report->sent, &report->received,
+		&report->expected, &report->packetsSent,
+		&report->packetsRecvd, &report->ticks,
+		&report->seconds, &report->dropped) == 8) {
+	    report->done = true;
+	} else if (sscanf(line, "Cluster latency %d %d", &usec, &n) == 2) {
+	    for (bucket = 0; bucket < LatencyBuckets - 1 &&
+					usec >= (2 << bucket); bucket++) {
+	    }
+	    report->latency[bucket] += n;
+	}
+    }
+    fclose(f);
+    (void) unlink(name);
+}
+
+//----------------------------------------------------------------------
+// PrintReport
+// 	Print each machine's counts, the totals, and the combined
+//	latency histogram.
+//----------------------------------------------------------------------
+
+static void
+PrintReport(int nodes, NodeReport *reports)
+{
+    int sent = 0, received = 0, expected = 0, packetsSent = 0;
+    int packetsRecvd = 0, dropped = 0, count = 0, sofar = 0;
+    int latency[LatencyBuckets];
+    char line[128];
+
+    for (int i = 0; i < LatencyBuckets; i++) {
+	latency[i] = 0;
+    }
+    cout << "node     sent  received  expected  pkts sent  pkts recvd"
+	 << "       ticks  host secs  dropped\n";
+    for (int id = 0; id < nodes; id++) {
+	NodeReport *r = &reports[id];
+
+	if (!r->done) {
+	    sprintf(line, "%4d  (no report)\n", id);
+	    cout << line;
+	    continue;
+	}
+	sprintf(line, "%4d %8d  %8d  %8d  %9d  %10d  %10d  %9.3f  %7d\n",
+		id, r->sent, r->received, r->expected, r->packetsSent,
+		r->packetsRecvd, r->ticks, r->seconds, r->dropped);
+	cout << line;
+	sent += r->sent;
+	received += r->received;
+	expected += r->expected;
+	packetsSent += r->packetsSent;
+	packetsRecvd += r->packetsRecvd;
+	dropped += r->dropped;
+	for (int i = 0; i < LatencyBuckets; i++) {
+	    latency[i] += r->latency[i];
+	    count += r->latency[i];
+	}
+    }
+    sprintf(line, "all  %8d  %8d  %8d  %9d  %10d  %10s  %9s  %7d\n",
+		sent, received, expected, packetsSent, packetsRecvd, "", "",
+		dropped);
+    cout << line;
+
+    cout << "\nlatency (host usec)     messages  cumulative\n";
+    for (int i = 0; i < LatencyBuckets; i++) {
+	if (latency[i] == 0) {
+	    continue;
+	}
+	sofar += latency[i];
+	sprintf(line, "%9d - %-9d  %9d  %9.1f%%\n", (i == 0) ? 0 : 1 << i,
+		(2 << i) - 1, latency[i], 100.0 * sofar / count);
+	cout << line;
+    }
+}
+
+//----------------------------------------------------------------------
+// RemoveScratch
+// 	Remove the scratch directory "dir", which we are in, and
+//	everything the machines left in it.
+//----------------------------------------------------------------------
+
+static void
+RemoveScratch(char *dir)
+{
+    DIR *d = opendir(".");
+    struct dirent *entry;
+
+    if (d != NULL) {
+	while ((entry = readdir(d)) != NULL) {
+	    if (strcmp(entry->d_name, ".") != 0 && 
+				strcmp(entry->d_name, "..") != 0) {
+		(void) unlink(entry->d_name);
+	    }
+	}
+	closedir(d);
+    }
+    if (chdir("/") < 0 || rmdir(dir) < 0) {
+	perror(dir);
+    }
+}
+
+//----------------------------------------------------------------------
+// main
+// 	Start the machines, give them ClusterTimeout seconds to finish
+//	(killing any that don't), and report.
+//----------------------------------------------------------------------
+
+int
+main(int argc, char **argv)
+{
+    int nodes, running, status;
+    char **nachosArgv;
+    char *nachos = getenv("NACHOS");
+    char *tmp = getenv("TMPDIR");
+    char nachosPath[PATH_MAX], scratch[PATH_MAX];
+    pid_t *pids;
+    NodeReport *reports;
+
+    if (argc < 4 || (nodes = atoi(argv[1])) < 2 || atoi(argv[3]) <= 0) {
+	cerr << "Usage: cluster nodes all|ring|fanin count [nachos flags]\n";
+	exit(1);
+    }
+
+    // the machines run in the scratch directory, so find nachos first
+    if (realpath((nachos != NULL) ? nachos : "./nachos", nachosPath) == NULL) {
+	perror((nachos != NULL) ? nachos : "./nachos");
+	exit(1);
+    }
+    snprintf(scratch, sizeof(scratch), "%s/cluster.XXXXXX", 
+					(tmp != NULL) ? tmp : "/tmp");
+    if (mkdtemp(scratch) == NULL || chdir(scratch) < 0) {
+	perror(scratch);
+	exit(1);
+    }
+
+    // nachos -m <id> -f -NC nodes pattern count [flags]; each machine
+    // formats its own DISK_<id> in the scratch directory
+    nachosArgv = new char *[argc + 5];
+    nachosArgv[0] = nachosPath;
+    nachosArgv[1] = (char *) "-m";
+    nachosArgv[3] = (char *) "-f";
+    nachosArgv[4] = (char *) "-NC";
+    for (int i = 1; i < argc; i++) {
+	nachosArgv[i + 4] = argv[i];
+    }
+    nachosArgv[argc + 4] = NULL;
+
+    pids = new pid_t[nodes];
+    reports = new NodeReport[nodes];
+    for (int id = 0; id < nodes; id++) {
+	pids[id] = StartNode(id, nachosArgv);
+    }
+
+    running = nodes;
+    for (int t = 0; running > 0 && t < ClusterTimeout * 10; t++) {
+	usleep(100000);
+	for (int id = 0; id < nodes; id++) {
+	    if (pids[id] > 0 && waitpid(pids[id], &status, WNOHANG) > 0) {
+		pids[id] = 0;
+		running--;
+	    }
+	}
+    }
+    for (int id = 0; id < nodes; id++) {
+	if (pids[id] > 0) {
+	    cerr << "Machine " << id << " timed out\n";
+	    kill(pids[id], SIGKILL);
+	    waitpid(pids[id], &status, 0);
+	}
+    }
+
+    for (int id = 0; id < nodes; id++) {
+	ReadReport(id, &reports[id]);
+    }
+    RemoveScratch(scratch);
+    cout << nodes << " machines, pattern " << argv[2] << ", " << argv[3]
+	 << " messages to each target\n\n";
+    PrintReport(nodes, reports);
+
+    delete [] nachosArgv;
+    delete [] pids;
+    delete [] reports;
+    return 0;
+}
@@ -0,0 +1,469 @@
+// netdisk.cc
+//	Routines to serve a disk to other machines over the post office,
+//	and to use a disk that another machine serves.
+//
+//	The server has a worker thread, taking one request at a time
+//	out of the server's mailbox, doing it on the local disk, and
+//	answering.  The client has two helper threads, like a
+//	transport connection (see transport.cc): one takes answers out
+//	of the client's mailbox and wakes up whoever made the request,
+//	the other sleeps until the oldest unanswered request is due to
+//	be sent again.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "netdisk.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// DiskServer::DiskServer
+//	Start the thread that serves a disk to other machines.
+//
+//	"disk" -- the disk to serve
+//----------------------------------------------------------------------
+
+DiskServer::DiskServer(SynchDisk *disk)
+{
+    Thread *t;
+
+    this->disk = disk;
+    t = new Thread("disk server", 1);
+    t->Fork(DiskServer::Worker, this);
+}
+
+//----------------------------------------------------------------------
+// DiskServer::Worker
+//	Take requests out of the server's mailbox, do them, and answer
+//	them, forever.  Anything that isn't a well-formed request is
+//	thrown away.
+//
+//	"arg" -- the server
+//----------------------------------------------------------------------
+
+void
+DiskServer::Worker(void *arg)
+{
+    DiskServer *_this = (DiskServer *)arg;
+    Mail *mail;
+    DiskMessage msg;
+    PacketHeader outPktHdr;
+    MailHeader outMailHdr;
+
+    for (;;) {
+	mail = kernel->postOfficeIn->ReceiveMail(DiskServerBox);
+	if (mail->mailHdr.length < DiskHeaderSize) {
+	    mail->Release();
+	    continue;
+	}
+	bcopy(mail->data, (char *)&msg, DiskHeaderSize);
+	if (msg.sector < 0 || msg.sector >= NumSectors
+		|| (msg.op == DiskRead
+			&& mail->mailHdr.length != DiskHeaderSize)
+		|| (msg.op == DiskWrite
+			&& mail->mailHdr.length != sizeof(DiskMessage))
+		|| (msg.op != DiskRead && msg.op != DiskWrite)) {
+	    mail->Release();
+	    continue;
+	}
+	outPktHdr.to = mail->pktHdr.from;
+	outMailHdr.to = mail->mailHdr.from;
+	outMailHdr.from = DiskServerBox;
+	if (msg.op == DiskRead) {
+	    mail->Release();
+	    DEBUG(dbgNet, "Disk server reading sector " << msg.sector
+					<< " for " << outPktHdr.to);
+	    _this->disk->ReadSector(msg.sector, msg.data);
+	    outMailHdr.length = sizeof(DiskMessage);
+	} else {
+	    bcopy(mail->data + DiskHeaderSize, msg.data, SectorSize);
+	    mail->Release();
+	    DEBUG(dbgNet, "Disk server writing sector " << msg.sector
+					<< " for " << outPktHdr.to);
+	    _this->disk->WriteSector(msg.sector, msg.data);
+	    outMailHdr.length = DiskHeaderSize;
+	}
+	kernel->postOfficeOut->Send(outPktHdr, outMailHdr, (char *)&msg);
+    }
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::NetworkDisk
+//	Initialize a client of another machine's disk, and start the
+//	helper threads that take in answers and send requests again.
+//
+//	"server" -- the machine with the disk
+//	"window" -- most requests that can be unanswered at once
+//----------------------------------------------------------------------
+
+NetworkDisk::NetworkDisk(NetworkAddress server, int window)
+    : SynchDisk(FALSE)
+{
+    Thread *t;
+
+    ASSERT(window > 0);
+    this->server = server;
+    windowSize = window;
+
+    lock = new Lock("network disk lock");
+    pending = new List<DiskRequest *>();
+    nextTag = 0;
+    windowOpen = new Condition("network disk window open");
+    answered = new Condition("network disk answered");
+    outstanding = new Condition("network disk outstanding");
+    smoothedLatency = 0;		// no estimate yet
+    latencyVariance = 0;
+    retryTime = MinDiskRetryTime;
+    numRequests = numRetransmitted = 0;
+    totalLatency = 0;
+
+    t = new Thread("network disk receiver", 1);
+    t->Fork(NetworkDisk::ReceiveHelper, this);
+    t = new Thread("network disk timer", 1);
+    t->Fork(NetworkDisk::TimerHelper, this);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::SendRequest
+//	Send a request to the server.  A write carries the sector's new
+//	contents; a read is just the header.
+//
+//	"request" -- what to ask for
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::SendRequest(DiskRequest *request)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    DiskMessage msg;
+
+    msg.op = request->op;
+    msg.tag = request->tag;
+    msg.sector = request->sector;
+    pktHdr.to = server;
+    mailHdr.to = DiskServerBox;
+    mailHdr.from = DiskClientBox;
+    if (request->op == DiskWrite) {
+	bcopy(request->data, msg.data, SectorSize);
+	mailHdr.length = sizeof(DiskMessage);
+    } else {
+	mailHdr.length = DiskHeaderSize;
+    }
+    kernel->postOfficeOut->Send(pktHdr, mailHdr, (char *)&msg);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::Start
+//	Send a new request, once there is room in the window.  The
+//	request goes on the network after the lock is released, so that
+//	answers can be taken in while the link is busy.
+//
+//	"request" -- where to keep track of it
+//	"op", "sector", "data" -- what to ask for
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::Start(DiskRequest *request, DiskOp op, int sector, char *data)
+{
+    ASSERT(0 <= sector && sector < NumSectors);
+    request->op = op;
+    request->sector = sector;
+    request->data = data;
+    request->answered = FALSE;
+
+    lock->Acquire();
+    while ((int)pending->NumInList() >= windowSize) {
+	windowOpen->Wait(lock);
+    }
+    request->tag = nextTag++;
+    request->issuedAt = request->sentAt = kernel->stats->totalTicks;
+    request->retryTime = retryTime;
+    request->retried = FALSE;
+    if (pending->IsEmpty()) {
+	outstanding->Signal(lock);
+    }
+    pending->Append(request);
+    numRequests++;
+    lock->Release();
+
+    SendRequest(request);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::Finish
+//	Wait until a request has been answered.
+//
+//	"request" -- the request
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::Finish(DiskRequest *request)
+{
+    lock->Acquire();
+    while (!request->answered) {
+	answered->Wait(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::ReadSector
+// 	Read the contents of a disk sector into a buffer.  Return only
+//	after the server has answered.
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::ReadSector(int sectorNumber, char* data)
+{
+    DiskRequest request;
+
+    Start(&request, DiskRead, sectorNumber, data);
+    Finish(&request);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::WriteSector
+// 	Write the contents of a buffer into a disk sector.  Return only
+//	after the server has answered.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::WriteSector(int sectorNumber, char* data)
+{
+    DiskRequest request;
+
+    Start(&request, DiskWrite, sectorNumber, data);
+    Finish(&request);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::ReadSectors
+// 	Read the contents of several disk sectors, sending the requests
+//	as fast as the window allows, and then waiting for them all.
+//
+//	"numSectors" -- how many sectors to read
+//	"sectors" -- which ones
+//	"data" -- the buffer to hold their contents, in the same order
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::ReadSectors(int numSectors, int *sectors, char *data)
+{
+    DiskRequest *requests = new DiskRequest[numSectors];
+
+    for (int i = 0; i < numSectors; i++) {
+	Start(&requests[i], DiskRead, sectors[i], &data[i * SectorSize]);
+    }
+    for (int i = 0; i < numSectors; i++) {
+	Finish(&requests[i]);
+    }
+    delete [] requests;
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::WriteSectors
+// 	Write the contents of several disk sectors, all at once.
+//
+//	"numSectors" -- how many sectors to write
+//	"sectors" -- which ones
+//	"data" -- their new contents, in the same order
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::WriteSectors(int numSectors, int *sectors, char *data)
+{
+    DiskRequest *requests = new DiskRequest[numSectors];
+
+    for (int i = 0; i < numSectors; i++) {
+	Start(&requests[i], DiskWrite, sectors[i], &data[i * SectorSize]);
+    }
+    for (int i = 0; i < numSectors; i++) {
+	Finish(&requests[i]);
+    }
+    delete [] requests;
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::Retransmit
+//	Send a request again, and move it to the end of the pending list,
+//	which is kept in the order requests were last sent.  Called with 
+//	the lock held, which is kept while the request is sent, so that 
+//	it can't be answered, and go away, underneath us.
+//
+//	"request" -- the request
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::Retransmit(DiskRequest *request)
+{
+    DEBUG(dbgNet, "Asking again for disk request " << request->tag);
+    request->sentAt = kernel->stats->totalTicks;
+    request->retried = TRUE;
+    pending->Remove(request);
+    pending->Append(request);
+    numRetransmitted++;
+    SendRequest(request);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::SampleLatency
+//	Fold how long a request took to be answered into the smoothed
+//	estimate, and its deviation, and set how long new requests wait
+//	for answers to the estimate plus four times the deviation, as
+//	Transport::SampleRTT does.
+//
+//	"latency" -- how long a request took, in ticks
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::SampleLatency(int latency)
+{
+    if (smoothedLatency == 0) {		// first measurement
+	smoothedLatency = latency;
+	latencyVariance = latency / 2;
+    } else {
+	int error = latency - smoothedLatency;
+
+	smoothedLatency += error / 8;
+	if (error < 0) {
+	    error = -error;
+	}
+	latencyVariance += (error - latencyVariance) / 4;
+    }
+    retryTime = smoothedLatency + 4 * latencyVariance;
+    retryTime = max(retryTime, MinDiskRetryTime);
+    retryTime = min(retryTime, MaxDiskRetryTime);
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::PrintStats
+// 	Print how many requests were made, how many had to be sent
+//	again, and how long they took to be answered.
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::PrintStats()
+{
+    cout << "Network disk: requests " << numRequests;
+    cout << ", retransmitted " << numRetransmitted;
+    if (numRequests > 0) {
+	cout << ", average latency " << totalLatency / numRequests
+	     << " ticks";
+    }
+    cout << "\n";
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::ReceiveHelper
+//	Take answers out of the client's mailbox as they arrive, and wake
+//	up whoever is waiting for each one.  An answer to a request that
+//	isn't pending -- a duplicate, because the request was sent
+//	again -- or from anyone but the server is thrown away.
+//
+//	Requests sent before the one answered, and still pending, were 
+//	lost, so they are sent again.  Only requests that were sent
+//	once say how long answers take: for the others, we can't tell
+//	which sending is being answered.
+//
+//	"arg" -- the client
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::ReceiveHelper(void *arg)
+{
+    NetworkDisk *_this = (NetworkDisk *)arg;
+    Mail *mail;
+    DiskMessage *msg;
+    DiskRequest *request;
+
+    for (;;) {
+	mail = kernel->postOfficeIn->ReceiveMail(DiskClientBox);
+	if (mail->pktHdr.from != _this->server
+		|| mail->mailHdr.length < DiskHeaderSize) {
+	    mail->Release();
+	    continue;
+	}
+	msg = (DiskMessage *)mail->data;
+
+	_this->lock->Acquire();
+	request = NULL;
+	ListIterator<DiskRequest *> iter(_this->pending);
+	for (; !iter.IsDone(); iter.Next()) {
+	    if (iter.Item()->tag == msg->tag) {
+		request = iter.Item();
+		break;
+	    }
+	}
+	if (request != NULL && (request->op == DiskWrite
+		    || mail->mailHdr.length == sizeof(DiskMessage))) {
+	    if (request->op == DiskRead) {
+		bcopy(msg->data, request->data, SectorSize);
+	    }
+	    while (_this->pending->Front() != request) {
+		_this->Retransmit(_this->pending->Front());
+	    }
+	    _this->pending->Remove(request);
+	    request->answered = TRUE;
+	    if (!request->retried) {
+		_this->SampleLatency(kernel->stats->totalTicks 
+						- request->sentAt);
+	    }
+	    _this->totalLatency += kernel->stats->totalTicks
+						- request->issuedAt;
+	    _this->answered->Broadcast(_this->lock);
+	    _this->windowOpen->Signal(_this->lock);
+	} else {
+	    DEBUG(dbgNet, "Dropping duplicate disk answer " << msg->tag);
+	}
+	_this->lock->Release();
+	mail->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// NetworkDisk::TimerHelper
+//	Whenever requests are pending, sleep until the one sent longest
+//	ago is due to be answered.  If it hasn't been by then, send it
+//	again, and double how long it and new requests get, in case the
+//	server or the network is just slow (the next answer to be timed
+//	brings it back down).
+//
+//	"arg" -- the client
+//----------------------------------------------------------------------
+
+void
+NetworkDisk::TimerHelper(void *arg)
+{
+    NetworkDisk *_this = (NetworkDisk *)arg;
+    DiskRequest *request;
+    int wait;
+
+    _this->lock->Acquire();
+    for (;;) {
+	while (_this->pending->IsEmpty()) {
+	    _this->outstanding->Wait(_this->lock);
+	}
+	request = _this->pending->Front();
+	wait = request->sentAt + request->retryTime
+					- kernel->stats->totalTicks;
+	if (wait > 0) {
+	    _this->lock->Release();
+	    kernel->alarm->WaitUntil(wait);
+	    _this->lock->Acquire();
+	} else {
+	    request->retryTime = min(2 * request->retryTime,
+						MaxDiskRetryTime);
+	    _this->retryTime = min(2 * _this->retryTime, MaxDiskRetryTime);
+	    _this->Retransmit(request);
+	}
+    }
+}
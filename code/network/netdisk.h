@@ -0,0 +1,172 @@
+// netdisk.h
+//	Data structures for a disk that is on another machine: one machine
+//	serves its disk over the post office, and others, with no disk
+//	of their own, use it as theirs.
+//
+//	Each request is one message to the server's mailbox, and is
+//	answered by one message back: a read's answer carries the
+//	sector, a write's answer just says it is done.  A client can
+//	have up to "window" requests waiting for their answers at once,
+//	so a file system read or write of many sectors costs about one
+//	round trip, rather than one per sector.
+//
+//	The post office can lose messages, so a request that goes
+//	unanswered for too long is sent again; how long is too long
+//	adapts to how long answers have been taking, as in a transport
+//	connection (see transport.h).  And since the network never
+//	reorders packets, and the server answers in the order it hears
+//	requests, an answer to a request means any sent before it that 
+//	are still unanswered were lost; they are sent again right away.
+//	Reads and writes of a sector can be done twice without harm, so
+//	the server doesn't have to notice duplicates; an answer to a 
+//	request that has already been answered is thrown away.
+//
+//	Nothing stops two clients from using one server's disk at once,
+//	but their file systems know nothing of each other, so they
+//	shouldn't both change it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef NETDISK_H
+#define NETDISK_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "list.h"
+#include "stats.h"
+#include "disk.h"
+#include "synchdisk.h"
+#include "post.h"
+#include "synch.h"
+
+// Mailboxes used by the server, and by a client for the answers
+
+const MailBoxAddress DiskServerBox = 5;
+const MailBoxAddress DiskClientBox = 6;
+
+// How long a client waits for an answer before asking again, in
+// ticks, is never less than one request could take the server's 
+// disk -- a seek across the whole disk, and a full rotation -- plus
+// a round trip.  Each time a request goes unanswered, it waits twice
+// as long, up to a limit.
+
+#define MinDiskRetryTime	(NumTracks * SeekTime \
+				+ SectorsPerTrack * RotationTime \
+				+ 4 * NetworkTime)
+#define MaxDiskRetryTime	(100000 * NetworkTime)
+
+enum DiskOp { DiskRead, DiskWrite };
+
+// The following class defines the messages between a client and the
+// server.  A read request, and a write's answer, are just the header:
+// the "data" is left off.
+
+class DiskMessage {
+  public:
+    int op;			// DiskRead or DiskWrite
+    unsigned tag;		// Matches an answer to its request
+    int sector;			// Which sector
+    char data[SectorSize];	// Its contents
+};
+
+#define DiskHeaderSize	(sizeof(DiskMessage) - SectorSize)
+
+// The following class defines a disk server, which reads and writes
+// a disk on this machine for other machines.  It lasts until Nachos
+// halts.
+//
+// There is only one thread doing the requests: the disk can only do
+// one at a time anyway, and with one thread, requests are answered
+// in the order they arrive, which clients count on.
+
+class DiskServer {
+  public:
+    DiskServer(SynchDisk *disk);	// Start serving "disk"
+
+  private:
+    SynchDisk *disk;		// where the sectors are
+
+    static void Worker(void *arg);
+				// Thread that takes in requests and answers
+				// them, in order
+};
+
+// A request that a client has sent, and not yet had answered.
+
+class DiskRequest {
+  public:
+    DiskOp op;			// read or write
+    unsigned tag;		// its number, for matching the answer
+    int sector;			// which sector
+    char *data;			// where the sector comes from or goes
+    int issuedAt;		// when it was first sent, in ticks
+    int sentAt;			// when it was last sent
+    int retryTime;		// how long to wait for an answer
+    bool retried;		// has it been sent more than once?
+    bool answered;		// has it been?
+};
+
+// The following class defines a client: a synchronous disk whose
+// sectors are on another machine.  The client's answers come to its
+// own mailbox, so there can only be one on each machine.  Like a
+// disk server, it lasts until Nachos halts, since its helper threads
+// never finish.
+
+class NetworkDisk : public SynchDisk {
+  public:
+    NetworkDisk(NetworkAddress server, int window);
+				// Use the disk served by machine "server",
+				// with up to "window" requests at once
+
+    void ReadSector(int sectorNumber, char* data);
+    void WriteSector(int sectorNumber, char* data);
+				// Read/write one sector, and wait for it
+
+    void ReadSectors(int numSectors, int *sectors, char *data);
+    void WriteSectors(int numSectors, int *sectors, char *data);
+				// Read/write several, all at once
+
+    void PrintStats();		// Print how the requests went
+
+  private:
+    NetworkAddress server;	// the machine with the disk
+    int windowSize;		// most requests waiting at once
+
+    Lock *lock;			// protects everything below
+    List<DiskRequest *> *pending; // requests not yet answered, in the
+				// order they were last sent
+    unsigned nextTag;		// tag for the next request
+    Condition *windowOpen;	// signalled when a request is answered
+    Condition *answered;	// broadcast when a request is answered
+    Condition *outstanding;	// signalled when a request is sent
+    int smoothedLatency;	// how long answers take, in ticks
+    int latencyVariance;	// how much that varies
+    int retryTime;		// how long new requests wait for answers
+
+    int numRequests;		// requests made
+    int numRetransmitted;	// requests sent again
+    int totalLatency;		// ticks from first sending each request
+				// to its answer, summed
+
+    void Start(DiskRequest *request, DiskOp op, int sector, char *data);
+				// Send a new request, waiting while the
+				// window is full
+    void Finish(DiskRequest *request);
+				// Wait for a request's answer
+    void SendRequest(DiskRequest *request);
+				// Put a request on the network
+    void Retransmit(DiskRequest *request);
+				// Send a request again
+    void SampleLatency(int latency);
+				// Update the retry time
+
+    static void ReceiveHelper(void *arg);
+				// Thread that takes in the answers
+    static void TimerHelper(void *arg);
+				// Thread that asks again when a request
+				// goes unanswered
+};
+
+#endif // NETDISK_H
@@ -21,21 +21,160 @@
 
 //----------------------------------------------------------------------
 // Mail::Mail
-//      Initialize a single mail message, by concatenating the headers to
-//	the data.
+//      Initialize a pool buffer.  The headers and data are filled in
+//	by the network, when a packet arrives.
+//----------------------------------------------------------------------
+
+Mail::Mail()
+{
+    data = buffer;
+    received = 0;
+    refCount = 0;
+    pool = NULL;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// Mail::Mail
+//      Initialize a single mail message, with room for all of its data.
+//	The data is filled in as the fragments arrive.  The message 
+//	starts out with one reference, belonging to the caller.
 //
 //	"pktH" -- source, destination machine ID's
 //	"mailH" -- source, destination mailbox ID's
-//	"data" -- payload data
 //----------------------------------------------------------------------
 
-Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
+Mail::Mail(PacketHeader pktH, MailHeader mailH)
 {
-    ASSERT(mailH.length <= MaxMailSize);
-
     pktHdr = pktH;
     mailHdr = mailH;
-    bcopy(msgData, data, mailHdr.length);
+    if (mailHdr.length <= MaxMailSize) {
+	data = buffer;
+    } else {
+	data = new char[mailHdr.length];
+    }
+    received = 0;
+    refCount = 1;
+    pool = NULL;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// Mail::~Mail
+//      De-allocate a mail message.
+//----------------------------------------------------------------------
+
+Mail::~Mail()
+{
+    if (data != buffer) {
+	delete [] data;
+    }
+}
+
+//----------------------------------------------------------------------
+// Mail::Hold
+//      Add a reference to a message, so it stays around after whoever
+//	gave it to us Releases it.
+//----------------------------------------------------------------------
+
+void
+Mail::Hold()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(refCount > 0);
+    refCount++;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Mail::Release
+//      Drop a reference to a message.  When the last one goes, put the
+//	message back in its pool, or delete it if it didn't come from one.
+//----------------------------------------------------------------------
+
+void
+Mail::Release()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(refCount > 0);
+    if (--refCount == 0) {
+	ASSERT(!IsOnList());	// not in a mailbox any more
+	if (pool != NULL) {
+	    pool->Free(this);
+	} else {
+	    delete this;
+	}
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// MailPool::MailPool
+//      Allocate a fixed number of packet-sized Mail buffers, all free.
+//
+//	"nBuffers" -- how many
+//----------------------------------------------------------------------
+
+MailPool::MailPool(int nBuffers)
+{
+    buffers = new Mail[nBuffers];
+    freeList = NULL;
+    for (int i = 0; i < nBuffers; i++) {
+	buffers[i].pool = this;
+	buffers[i].next = freeList;
+	freeList = &buffers[i];
+    }
+    // the network fills in the MailHeader and data with one copy
+    ASSERT(buffers[0].buffer == Packet(&buffers[0]) + sizeof(MailHeader));
+}
+
+//----------------------------------------------------------------------
+// MailPool::~MailPool
+//      De-allocate the buffers.  They had all better be back.
+//----------------------------------------------------------------------
+
+MailPool::~MailPool()
+{
+    delete [] buffers;
+}
+
+//----------------------------------------------------------------------
+// MailPool::Allocate
+//      Take a buffer out of the pool.  It starts with one reference,
+//	belonging to the caller.  Returns NULL if the pool is empty.
+//----------------------------------------------------------------------
+
+Mail *
+MailPool::Allocate()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Mail *mail = freeList;
+
+    if (mail != NULL) {
+	freeList = mail->next;
+	mail->refCount = 1;
+	mail->received = 0;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return mail;
+}
+
+//----------------------------------------------------------------------
+// MailPool::Free
+//      Put a buffer back in the pool, once nobody refers to it.
+//----------------------------------------------------------------------
+
+void
+MailPool::Free(Mail *mail)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(mail->pool == this && mail->refCount == 0);
+    mail->next = freeList;
+    freeList = mail;
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -50,6 +189,7 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 MailBox::MailBox()
 { 
     messages = new SynchList<Mail *>(); 
+    partial = new List<Mail *>();
 }
 
 //----------------------------------------------------------------------
@@ -57,11 +197,19 @@ MailBox::MailBox()
 //      De-allocate a single mail box within the post office.
 //
 //	Just delete the mailbox, and throw away all the queued messages 
-//	in the mailbox.
+//	in the mailbox, and any that were only partly reassembled.
+//
+//	This only happens when Nachos halts, so we don't Release the 
+//	messages: that would turn interrupts back on, after the network 
+//	has gone.  The pool's buffers go away with the pool.
 //----------------------------------------------------------------------
 
 MailBox::~MailBox()
 { 
+    while (!partial->IsEmpty()) {
+	delete partial->RemoveFront();
+    }
+    delete partial;
     delete messages; 
 }
 
@@ -83,25 +231,84 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 
 //----------------------------------------------------------------------
 // MailBox::Put
-// 	Add a message to the mailbox.  If anyone is waiting for message
-//	arrival, wake them up!
+// 	Add a fragment to the message it belongs to.  Once all of the
+//	message has arrived, add it to the mailbox.  If anyone is waiting 
+//	for message arrival, wake them up!
 //
-//	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	A message that fits in one packet goes straight into the mailbox,
+//	without being copied.  Otherwise, the fragments are copied into 
+//	a Mail on the "partial" list, found by the sending machine and
+//	mailbox and the message id, and the fragment itself is Released.
+//	The network keeps packets in order, so each fragment must start
+//	where the previous one ended; if one doesn't, a fragment was
+//	dropped, and the message is thrown away.  So is one whose 
+//	fragments disagree about its length.  PostalDelivery has already
+//	checked that the fragment fits within the message, and that the
+//	message is no longer than MaxMessageLength.  At most MaxReassembly
+//	messages can be in progress; the oldest is dropped to make room
+//	for a new one.
 //
-//	"pktHdr" -- source, destination machine ID's
-//	"mailHdr" -- source, destination mailbox ID's
-//	"data" -- payload message data
+//	"fragment" -- a packet that has just arrived; our reference to it
+//		is passed on to the mailbox, or Released
 //----------------------------------------------------------------------
 
 void 
-MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
+MailBox::Put(Mail *fragment)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
-
-    messages->Append(mail);		// put on the end of the list of 
+    PacketHeader pktHdr = fragment->pktHdr;
+    MailHeader mailHdr = fragment->mailHdr;
+    unsigned size = pktHdr.length - sizeof(MailHeader);
+    ListIterator<Mail *> iter(partial);
+    Mail *mail = NULL;
+
+    if (mailHdr.offset == 0 && size == mailHdr.length) {	// whole
+	fragment->received = size;
+	messages->Append(fragment);	// put on the end of the list of 
 					// arrived messages, and wake up 
 					// any waiters
+	return;
+    }
+
+    for (; !iter.IsDone(); iter.Next()) {
+	Mail *m = iter.Item();
+	if (m->pktHdr.from == pktHdr.from && 
+		m->mailHdr.from == mailHdr.from && 
+		m->mailHdr.msgId == mailHdr.msgId) {
+	    mail = m;
+	    break;
+	}
+    }
+
+    if (mail == NULL) {
+	if (mailHdr.offset != 0) {	// lost the start of the message
+	    DEBUG(dbgNet, "Dropping fragment of a lost message " << 
+					mailHdr.msgId);
+	    fragment->Release();
+	    return;
+	}
+	mail = new Mail(pktHdr, mailHdr);
+	if (partial->NumInList() == MaxReassembly) {
+	    DEBUG(dbgNet, "No room to reassemble, dropping a message");
+	    partial->RemoveFront()->Release();
+	}
+	partial->Append(mail);
+    } else if (mailHdr.offset != mail->received 
+		|| mailHdr.length != mail->mailHdr.length) {
+	DEBUG(dbgNet, "Lost a fragment of message " << mailHdr.msgId);
+	partial->Remove(mail);
+	mail->Release();
+	fragment->Release();
+	return;
+    }
+
+    bcopy(fragment->data, mail->data + mail->received, size);
+    mail->received += size;
+    fragment->Release();
+
+    if (mail->IsComplete()) {
+	partial->Remove(mail);
+	messages->Append(mail);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -114,26 +321,68 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 //	"pktHdr" -- address to put: source, destination machine ID's
 //	"mailHdr" -- address to put: source, destination mailbox ID's
 //	"data" -- address to put: payload message data
+//	"size" -- most bytes of data to copy into "data"; the rest of a
+//		longer message is discarded, but mailHdr->length still
+//		says how long it was
 //----------------------------------------------------------------------
 
 void 
-MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
+MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data,
+		int size) 
+{ 
+    Mail *mail = GetMail();
+
+    *pktHdr = mail->pktHdr;
+    *mailHdr = mail->mailHdr;
+    bcopy(mail->data, data, min((int)mail->mailHdr.length, size));
+					// copy the message data into
+					// the caller's buffer
+    mail->Release();			// we've copied out the stuff we
+					// need, we can now discard the message
+}
+
+//----------------------------------------------------------------------
+// MailBox::GetMail
+// 	Get a message from a mailbox, waiting if there isn't one yet.
+//	The mailbox's reference to the message passes to the caller, who
+//	must Release it when done with it.
+//----------------------------------------------------------------------
+
+Mail *
+MailBox::GetMail() 
 { 
     DEBUG(dbgNet, "Waiting for mail in mailbox");
     Mail *mail = messages->RemoveFront();	// remove message from list;
 						// will wait if list is empty
 
-    *pktHdr = mail->pktHdr;
-    *mailHdr = mail->mailHdr;
     if (debug->IsEnabled('n')) {
 	cout << "Got mail from mailbox: ";
-	PrintHeader(*pktHdr, *mailHdr);
+	PrintHeader(mail->pktHdr, mail->mailHdr);
     }
-    bcopy(mail->data, data, mail->mailHdr.length);
-					// copy the message data into
-					// the caller's buffer
-    delete mail;			// we've copied out the stuff we
-					// need, we can now discard the message
+    kernel->stats->numMailRecvd++;
+    return mail;
+}
+
+//----------------------------------------------------------------------
+// MailBox::TryGetMail
+// 	Get a message from a mailbox, as in GetMail, if there is one.
+//	Return NULL if there isn't, rather than waiting.
+//----------------------------------------------------------------------
+
+Mail *
+MailBox::TryGetMail() 
+{ 
+    Mail *mail;
+
+    if (!messages->TryRemoveFront(&mail)) {
+	return NULL;
+    }
+    if (debug->IsEnabled('n')) {
+	cout << "Got mail from mailbox: ";
+	PrintHeader(mail->pktHdr, mail->mailHdr);
+    }
+    kernel->stats->numMailRecvd++;
+    return mail;
 }
 
 //----------------------------------------------------------------------
@@ -156,6 +405,7 @@ PostOfficeInput::PostOfficeInput(int nBoxes)
 
     numBoxes = nBoxes;
     boxes = new MailBox[nBoxes];
+    pool = new MailPool(NumMailBuffers);
 
     network = new NetworkInput(this);
 
@@ -177,6 +427,7 @@ PostOfficeInput::~PostOfficeInput()
 {
     delete network;
     delete [] boxes;
+    delete pool;
 }
 
 //----------------------------------------------------------------------
@@ -185,6 +436,9 @@ PostOfficeInput::~PostOfficeInput()
 //
 //      Incoming messages have had the PacketHeader stripped off,
 //	but the MailHeader is still tacked on the front of the data.
+//	Each one is read straight into a buffer from the pool, which is 
+//	laid out the same way.  If the pool is empty, the packet is read 
+//	into a scratch buffer and dropped.
 //----------------------------------------------------------------------
 
 void
@@ -193,14 +447,22 @@ PostOfficeInput::PostalDelivery(void* data)
     PostOfficeInput* _this = (PostOfficeInput*)data;
     PacketHeader pktHdr;
     MailHeader mailHdr;
-    char *buffer = new char[MaxPacketSize];
+    char *scratch = new char[MaxPacketSize];
+    Mail *mail;
 
     for (;;) {
         // first, wait for a message
         _this->messageAvailable->P();	
-        pktHdr = _this->network->Receive(buffer);
-
-        mailHdr = *(MailHeader *)buffer;
+	mail = _this->pool->Allocate();
+	if (mail == NULL) {
+	    DEBUG(dbgNet, "Out of mail buffers, dropping a packet");
+	    (void) _this->network->Receive(scratch);
+	    continue;
+	}
+        pktHdr = _this->network->Receive(_this->pool->Packet(mail));
+	mail->pktHdr = pktHdr;
+
+        mailHdr = mail->mailHdr;
         if (debug->IsEnabled('n')) {
 	    cout << "Putting mail into mailbox: ";
 	    PrintHeader(pktHdr, mailHdr);
@@ -208,10 +470,18 @@ PostOfficeInput::PostalDelivery(void* data)
 
 	// check that arriving message is legal!
 	ASSERT(0 <= mailHdr.to && mailHdr.to < _this->numBoxes);
-	ASSERT(mailHdr.length <= MaxMailSize);
+	if (pktHdr.length < sizeof(MailHeader)
+		|| mailHdr.length > MaxMessageLength
+		|| pktHdr.length - sizeof(MailHeader) > mailHdr.length
+		|| mailHdr.offset > mailHdr.length - 
+				(pktHdr.length - sizeof(MailHeader))) {
+	    DEBUG(dbgNet, "Dropping a packet with a bad mail header");
+	    mail->Release();
+	    continue;
+	}
 
 	// put into mailbox
-        _this->boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+        _this->boxes[mailHdr.to].Put(mail);
     }
 }
 
@@ -228,16 +498,49 @@ PostOfficeInput::PostalDelivery(void* data)
 //	"pktHdr" -- address to put: source, destination machine ID's
 //	"mailHdr" -- address to put: source, destination mailbox ID's
 //	"data" -- address to put: payload message data
+//	"size" -- room in "data"
 //----------------------------------------------------------------------
 
 void
 PostOfficeInput::Receive(int box, PacketHeader *pktHdr, 
-				MailHeader *mailHdr, char* data)
+				MailHeader *mailHdr, char* data, int size)
 {
     ASSERT((box >= 0) && (box < numBoxes));
 
-    boxes[box].Get(pktHdr, mailHdr, data);
-    ASSERT(mailHdr->length <= MaxMailSize);
+    boxes[box].Get(pktHdr, mailHdr, data, size);
+}
+
+//----------------------------------------------------------------------
+// PostOfficeInput::ReceiveMail
+// 	Retrieve a message from a specific box, waiting for one to 
+//	arrive if need be, and return it without copying the data.  The
+//	caller must Release the message when done with it.
+//
+//	"box" -- mailbox ID in which to look for message
+//----------------------------------------------------------------------
+
+Mail *
+PostOfficeInput::ReceiveMail(int box)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+
+    return boxes[box].GetMail();
+}
+
+//----------------------------------------------------------------------
+// PostOfficeInput::TryReceiveMail
+// 	Retrieve a message from a specific box, as in ReceiveMail, if
+//	there is one there.  Return NULL if not.
+//
+//	"box" -- mailbox ID in which to look for message
+//----------------------------------------------------------------------
+
+Mail *
+PostOfficeInput::TryReceiveMail(int box)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+
+    return boxes[box].TryGetMail();
 }
 
 //----------------------------------------------------------------------
@@ -267,6 +570,7 @@ PostOfficeOutput::PostOfficeOutput(double reliability)
 {
     messageSent = new Semaphore("message sent", 0);
     sendLock = new Lock("message send lock");
+    nextMsgId = 0;
 
     network = new NetworkOutput(reliability, this);
 }
@@ -287,6 +591,10 @@ PostOfficeOutput::~PostOfficeOutput()
 // PostOfficeOutput::Send
 // 	Concatenate the MailHeader to the front of the data, and pass 
 //	the result to the Network for delivery to the destination machine.
+//	Messages longer than MaxMailSize go out as a series of fragments,
+//	each with its own copy of the MailHeader saying where its data
+//	goes.  The send lock is held for the whole message, so the
+//	fragments of different messages don't get mixed together.
 //
 //	Note that the MailHeader + data looks just like normal payload
 //	data to the Network.
@@ -306,22 +614,32 @@ PostOfficeOutput::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 	cout << "Post send: ";
 	PrintHeader(pktHdr, mailHdr);
     }
-    ASSERT(mailHdr.length <= MaxMailSize);
     ASSERT(0 <= mailHdr.to);
+    ASSERT(mailHdr.length <= MaxMessageLength);
+    kernel->stats->numMailSent++;
     
     // fill in pktHdr, for the Network layer
     pktHdr.from = kernel->hostName;
-    pktHdr.length = mailHdr.length + sizeof(MailHeader);
-
-    // concatenate MailHeader and data
-    bcopy((char *)&mailHdr, buffer, sizeof(MailHeader));
-    bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
 
     sendLock->Acquire();   		// only one message can be sent
 					// to the network at any one time
-    network->Send(pktHdr, buffer);
-    messageSent->P();			// wait for interrupt to tell us
-					// ok to send the next message
+    mailHdr.msgId = nextMsgId++;
+    mailHdr.offset = 0;
+    do {
+	unsigned size = min(mailHdr.length - mailHdr.offset, 
+						(unsigned)MaxMailSize);
+
+	pktHdr.length = size + sizeof(MailHeader);
+
+	// concatenate MailHeader and this fragment's data
+	bcopy((char *)&mailHdr, buffer, sizeof(MailHeader));
+	bcopy(data + mailHdr.offset, buffer + sizeof(MailHeader), size);
+
+	network->Send(pktHdr, buffer);
+	messageSent->P();		// wait for interrupt to tell us
+					// ok to send the next packet
+	mailHdr.offset += size;
+    } while (mailHdr.offset < mailHdr.length);
     sendLock->Release();
 
     delete [] buffer;			// we've sent the message, so
@@ -20,6 +20,12 @@
 //	to which you can send an acknowledgement, if your protocol requires 
 //	this.
 //
+//	Messages can be larger than a single packet: the post office splits
+//	them into fragments on the way out, and the mailbox glues the
+//	fragments back together on the way in.  Since the network never
+//	reorders packets, a fragment that doesn't pick up where the last
+//	one left off means one was dropped, and the whole message is lost.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -47,30 +53,108 @@ class MailHeader {
     MailBoxAddress to;		// Destination mail box
     MailBoxAddress from;	// Mail box to reply to
     unsigned length;		// Bytes of message data (excluding the 
-				// mail header)
+				// mail header), summed over all fragments
+    unsigned msgId;		// Which message this fragment is part of
+    unsigned offset;		// Where this fragment's data goes in the
+				// message
 };
 
-// Maximum "payload" -- real data -- that can included in a single message
-// Excluding the MailHeader and the PacketHeader
+// Maximum "payload" -- real data -- that can included in a single packet
+// Excluding the MailHeader and the PacketHeader.  Longer messages are
+// sent as several fragments.
 
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
+// Longest message the post office will send, or reassemble.  The 
+// length in an arriving MailHeader comes from another machine, so a
+// fragment of a longer message is dropped rather than trusted to size
+// the reassembly buffer.
+
+#define MaxMessageLength (64 * 1024)
+
+// Most messages a mailbox will be in the middle of reassembling at once;
+// if another one starts arriving, the oldest is thrown away.
+
+#define MaxReassembly	4
+
+// Number of buffers each post office has for arriving packets.  A 
+// packet that arrives when they are all in use is dropped.
+
+#define NumMailBuffers	64
+
+class MailPool;
 
 // The following class defines the format of an incoming/outgoing 
 // "Mail" message.  The message format is layered: 
 //	network header (PacketHeader) 
 //	post office header (MailHeader) 
 //	data
+//
+// A Mail holds the whole message, which may still be waiting for some
+// of its fragments.  
+//
+// Mail that fits in a single packet comes from a fixed pool, and the 
+// network copies the packet straight into it; the same buffer then 
+// goes into the mailbox, and on to whoever receives it.  Bigger
+// messages are reassembled into a Mail of their own.  Either way, a 
+// Mail is reference counted: Hold it to pass it on to someone else, 
+// and Release it when done with it.  The last Release puts it back 
+// in its pool, or deletes it.
+//
+// Mail is on one list at a time at most -- a mailbox's "partial" list,
+// or its list of arrived messages -- so it carries its own ListElement
+// (list.h), and delivering mail allocates nothing.
 
-class Mail {
+class Mail : public ListEmbedded<Mail> {
   public:
-     Mail(PacketHeader pktH, MailHeader mailH, char *msgData);
-				// Initialize a mail message by
-				// concatenating the headers to the data
+     Mail();			// Initialize an empty pool buffer
+     Mail(PacketHeader pktH, MailHeader mailH);
+				// Initialize a mail message with room
+				// for all of its data
+     ~Mail();			// De-allocate the message data
+
+     bool IsComplete() { return received == mailHdr.length; }
+     void Hold();		// Add a reference
+     void Release();		// Drop a reference
 
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
-     char data[MaxMailSize];	// Payload -- message data
+     char buffer[MaxMailSize];	// Payload of a single packet; must 
+				// follow mailHdr directly, so the network
+				// can fill in both at once
+     char *data;		// Payload -- message data, in "buffer"
+				// unless it is too big
+     unsigned received;		// Bytes of data that have arrived so far
+
+  private:
+     friend class MailPool;
+     int refCount;		// How many Holds are outstanding
+     MailPool *pool;		// Where to return it, or NULL
+     Mail *next;		// Next free buffer in the pool
+};
+
+template <> class ListElementSource<Mail *>
+		: public EmbeddedListElements<Mail> {};
+
+// The following class defines a fixed pool of Mail buffers, each big
+// enough for one packet.
+
+class MailPool {
+  public:
+    MailPool(int nBuffers);	// Allocate the buffers
+    ~MailPool();		// De-allocate them
+
+    Mail *Allocate();		// Take a buffer, with one reference;
+				// NULL if there are none left
+    void Free(Mail *mail);	// Put a buffer back
+
+    char *Packet(Mail *mail) { return (char *)&mail->mailHdr; }
+				// Where the network should put a packet's
+				// MailHeader and data
+
+  private:
+    Mail *buffers;		// all of the buffers
+    Mail *freeList;		// the ones not in use
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -83,14 +167,20 @@ class MailBox {
     MailBox();			// Allocate and initialize mail box
     ~MailBox();			// De-allocate mail box
 
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
-    void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
+    void Put(Mail *fragment);	// Add a fragment to the message it belongs
+				// to, and atomically put the message into
+				// the mailbox once it is complete
+    void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data,
+		int size); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
+    Mail *GetMail();		// Same, but hand over the message itself
+    Mail *TryGetMail();		// Same, but return NULL instead of waiting
   private:
     SynchList<Mail *> *messages; // A mailbox is just a list of arrived messages
+    List<Mail *> *partial;	// Messages still being reassembled, oldest
+				// first; only the postal worker uses this
 };
 
 // The following two classes defines a "Post Office", or a collection of 
@@ -108,9 +198,17 @@ class PostOfficeInput : public CallBackObj {
     ~PostOfficeInput();		// De-allocate Post Office data
     
     void Receive(int box, PacketHeader *pktHdr, 
-		MailHeader *mailHdr, char *data);
-    				// Retrieve a message from "box".  Wait if
-				// there is no message in the box.
+		MailHeader *mailHdr, char *data, int size);
+    				// Retrieve a message from "box", copying
+				// at most "size" bytes of it into "data".
+				// Wait if there is no message in the box.
+    Mail *ReceiveMail(int box);	// Same, but return the message without
+				// copying it; the caller must Release it
+    Mail *TryReceiveMail(int box);
+				// Same, but return NULL if there is no
+				// message in the box, rather than waiting
+
+    int NumBoxes() { return numBoxes; }
 
     static void PostalDelivery(void* data);
 				// Wait for incoming messages, 
@@ -124,6 +222,7 @@ class PostOfficeInput : public CallBackObj {
     NetworkInput *network;	// Physical network connection
     MailBox *boxes;		// Table of mail boxes to hold incoming mail
     int numBoxes;		// Number of mail boxes
+    MailPool *pool;		// Buffers for arriving packets
     Semaphore *messageAvailable;// V'ed when message has arrived from network
 };
 
@@ -136,9 +235,10 @@ class PostOfficeOutput : public CallBackObj {
     ~PostOfficeOutput();	// De-allocate Post Office data
 
     void Send(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-    				// Send a message to a mailbox on a remote 
-				// machine.  The fromBox in the MailHeader is 
-				// the return box for ack's.
+    				// Send a message of any length to a
+				// mailbox on a remote machine.  The fromBox
+				// in the MailHeader is the return box for
+				// ack's.
 
     void CallBack();		// Called when outgoing packet has been 
 				// put on network; next packet can now be sent
@@ -147,5 +247,6 @@ class PostOfficeOutput : public CallBackObj {
     NetworkOutput *network;	// Physical network connection
     Semaphore *messageSent;	// V'ed when next message can be sent to network
     Lock *sendLock;		// Only one outgoing message at a time
+    unsigned nextMsgId;		// Tags the fragments of the next message
 };
 #endif
@@ -0,0 +1,443 @@
+// transport.cc
+//	Routines to send a stream of bytes reliably, and in order, over
+//	the unreliable post office, using a sliding window of numbered
+//	segments with cumulative acknowledgements.
+//
+//	Each connection has two helper threads: one takes segments and
+//	acknowledgements out of the connection's mailbox, the other sleeps
+//	on the alarm clock until the oldest unacknowledged segment is due
+//	to be sent again.
+//
+//	New segments are put on the network after the connection's lock
+//	is released, so that acknowledgements can be processed while the
+//	link is busy.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "transport.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Segment::Segment
+//	Save a copy of a segment's data, until it is acknowledged (for
+//	a segment we sent) or Received (for one that arrived).
+//
+//	"segData" -- the data
+//	"segSize" -- how many bytes of it
+//----------------------------------------------------------------------
+
+Segment::Segment(char *segData, int segSize)
+{
+    data = new char[segSize];
+    bcopy(segData, data, segSize);
+    size = segSize;
+    sentAt = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Transport::Transport
+//	Initialize one end of a connection, and start the helper threads
+//	that handle arriving segments and retransmissions.
+//
+//	"localBox" -- mailbox on this machine for data and ACKs
+//	"remoteHost", "remoteBox" -- where the other end is
+//	"window" -- most segments that can be unacknowledged at once
+//----------------------------------------------------------------------
+
+Transport::Transport(MailBoxAddress localBox, NetworkAddress remoteHost,
+			MailBoxAddress remoteBox, int window)
+{
+    Thread *t;
+
+    ASSERT(window > 0);
+    local = localBox;
+    remote = remoteHost;
+    this->remoteBox = remoteBox;
+    windowSize = window;
+
+    lock = new Lock("transport lock");
+
+    sendWindow = new Segment *[window];
+    recvWindow = new Segment *[window];
+    for (int i = 0; i < window; i++) {
+	sendWindow[i] = NULL;
+	recvWindow[i] = NULL;
+    }
+    sendBase = nextSeq = 0;
+    timerStart = 0;
+    smoothedRTT = 0;			// no estimate yet
+    rttVariance = 0;
+    retransmitTime = InitialRetransmitTime;
+    windowOpen = new Condition("transport window open");
+    outstanding = new Condition("transport outstanding");
+    numSent = numRetransmitted = 0;
+
+    recvNext = 0;
+    echoTime = 0;
+    delivered = new List<Segment *>();
+    deliveredOffset = 0;
+    dataAvailable = new Condition("transport data available");
+
+    t = new Thread("transport receiver", 1);
+    t->Fork(Transport::ReceiveHelper, this);
+    t = new Thread("transport timer", 1);
+    t->Fork(Transport::TimerHelper, this);
+}
+
+//----------------------------------------------------------------------
+// Transport::MakeHeader
+//	Fill in the header for a segment.  Every segment carries an 
+//	acknowledgement of what we have received so far, which the
+//	receiver thread updates, so this is called with the lock held.
+//
+//	"seq" -- the segment's number
+//	"time" -- when we say it was sent
+//----------------------------------------------------------------------
+
+SegmentHeader
+Transport::MakeHeader(unsigned seq, int time)
+{
+    SegmentHeader segHdr;
+
+    ASSERT(lock->IsHeldByCurrentThread());
+    segHdr.seq = seq;
+    segHdr.ack = recvNext;
+    segHdr.time = time;
+    segHdr.echo = echoTime;
+    return segHdr;
+}
+
+//----------------------------------------------------------------------
+// Transport::SendSegment
+//	Prepend the segment header to the data, and send it to the other
+//	end.  Touches nothing shared, so it can be called without the 
+//	lock.
+//
+//	"segHdr" -- its header, from MakeHeader
+//	"data", "size" -- its data; a segment with no data is just an ACK
+//----------------------------------------------------------------------
+
+void
+Transport::SendSegment(SegmentHeader segHdr, char *data, int size)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    char buffer[MaxMailSize];
+
+    ASSERT(0 <= size && size <= (int)MaxSegmentSize);
+    bcopy((char *)&segHdr, buffer, sizeof(SegmentHeader));
+    bcopy(data, buffer + sizeof(SegmentHeader), size);
+
+    pktHdr.to = remote;
+    mailHdr.to = remoteBox;
+    mailHdr.from = local;
+    mailHdr.length = sizeof(SegmentHeader) + size;
+    kernel->postOfficeOut->Send(pktHdr, mailHdr, buffer);
+}
+
+//----------------------------------------------------------------------
+// Transport::Send
+//	Send a stream of bytes to the other end, one segment at a time.
+//	Returns once the last segment has been sent (but not necessarily
+//	acknowledged -- see Flush).  Waits while the window is full.
+//
+//	"data" -- the bytes to send
+//	"size" -- how many of them
+//----------------------------------------------------------------------
+
+void
+Transport::Send(char *data, int size)
+{
+    while (size > 0) {
+	int n = min(size, (int)MaxSegmentSize);
+	unsigned seq;
+	int time;
+	SegmentHeader segHdr;
+
+	lock->Acquire();
+	while (nextSeq - sendBase >= (unsigned)windowSize) {
+	    windowOpen->Wait(lock);
+	}
+	seq = nextSeq++;
+	sendWindow[seq % windowSize] = new Segment(data, n);
+	time = sendWindow[seq % windowSize]->sentAt;
+	if (seq == sendBase) {		// start the retransmission timer
+	    timerStart = time;
+	    outstanding->Signal(lock);
+	}
+	numSent++;
+	segHdr = MakeHeader(seq, time);
+	lock->Release();
+
+	SendSegment(segHdr, data, n);
+	data += n;
+	size -= n;
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::Flush
+//	Wait until the other end has acknowledged everything we sent.
+//----------------------------------------------------------------------
+
+void
+Transport::Flush()
+{
+    lock->Acquire();
+    while (sendBase != nextSeq) {
+	windowOpen->Wait(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Transport::Receive
+//	Wait until some data has arrived in order, and return as much of
+//	it as will fit.  Segment boundaries aren't preserved: a segment
+//	may be split over several Receives, and one Receive may return
+//	the data from several segments.
+//
+//	"data" -- where to put the bytes
+//	"size" -- room in "data"
+//----------------------------------------------------------------------
+
+int
+Transport::Receive(char *data, int size)
+{
+    int copied = 0;
+
+    lock->Acquire();
+    while (delivered->IsEmpty()) {
+	dataAvailable->Wait(lock);
+    }
+    while (copied < size && !delivered->IsEmpty()) {
+	Segment *seg = delivered->Front();
+	int n = min(size - copied, seg->size - deliveredOffset);
+
+	bcopy(seg->data + deliveredOffset, data + copied, n);
+	copied += n;
+	deliveredOffset += n;
+	if (deliveredOffset == seg->size) {
+	    delete delivered->RemoveFront();
+	    deliveredOffset = 0;
+	}
+    }
+    lock->Release();
+    return copied;
+}
+
+//----------------------------------------------------------------------
+// Transport::Retransmit
+//	Send the oldest unacknowledged segment again, and restart the
+//	retransmission timer.  Called with the lock held; unlike new
+//	segments, the lock is kept while the segment is sent, so that
+//	it can't be acknowledged and freed underneath us.
+//----------------------------------------------------------------------
+
+void
+Transport::Retransmit()
+{
+    Segment *seg = sendWindow[sendBase % windowSize];
+
+    ASSERT(sendBase != nextSeq);
+    DEBUG(dbgNet, "Retransmitting segment " << sendBase);
+    seg->sentAt = kernel->stats->totalTicks;
+    numSent++;
+    numRetransmitted++;
+    timerStart = seg->sentAt;
+    SendSegment(MakeHeader(sendBase, seg->sentAt), seg->data, seg->size);
+}
+
+//----------------------------------------------------------------------
+// Transport::SampleRTT
+//	Fold a measured round trip time into the smoothed estimate of the
+//	round trip time and its deviation (Jacobson's algorithm, as in
+//	TCP), and set the retransmission timeout to the estimate plus
+//	four times the deviation.  This also undoes any backing off after
+//	timeouts: the ACK shows the network is getting through again.
+//
+//	"rtt" -- how long a segment took to be acknowledged, in ticks
+//----------------------------------------------------------------------
+
+void
+Transport::SampleRTT(int rtt)
+{
+    if (smoothedRTT == 0) {		// first measurement
+	smoothedRTT = rtt;
+	rttVariance = rtt / 2;
+    } else {
+	int error = rtt - smoothedRTT;
+
+	smoothedRTT += error / 8;
+	if (error < 0) {
+	    error = -error;
+	}
+	rttVariance += (error - rttVariance) / 4;
+    }
+    retransmitTime = smoothedRTT + 4 * rttVariance;
+    retransmitTime = max(retransmitTime, MinRetransmitTime);
+    retransmitTime = min(retransmitTime, MaxRetransmitTime);
+}
+
+//----------------------------------------------------------------------
+// Transport::GotAck
+//	The other end says it has everything before segment "ack", and
+//	that the last segment it heard from us was the one we sent at
+//	time "echo".  Free the segments that covers, and let Send put
+//	more on the network.
+//
+//	The echo gives a round trip time.  And since packets stay in
+//	order, if the segment it echoes was sent after the oldest one
+//	still unacknowledged, that one was lost: send it again right
+//	away, rather than waiting for the timer.  Once it has been sent
+//	again, only echoes of segments sent after that count.
+//
+//	Called with the lock held.
+//
+//	"ack" -- the next segment the other end wants
+//	"echo" -- when we sent the segment it is replying to, or 0
+//----------------------------------------------------------------------
+
+void
+Transport::GotAck(unsigned ack, int echo)
+{
+    if (ack - sendBase > nextSeq - sendBase) {	// old, or nonsense
+	return;
+    }
+    if (echo != 0) {
+	SampleRTT(kernel->stats->totalTicks - echo);
+    }
+    if (ack != sendBase) {
+	while (sendBase != ack) {
+	    delete sendWindow[sendBase % windowSize];
+	    sendWindow[sendBase % windowSize] = NULL;
+	    sendBase++;
+	}
+	timerStart = kernel->stats->totalTicks;
+	windowOpen->Broadcast(lock);
+    }
+    if (sendBase != nextSeq &&
+		echo > sendWindow[sendBase % windowSize]->sentAt) {
+	Retransmit();
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::GotData
+//	A segment has arrived.  Keep it if it falls in the window and we
+//	don't already have it, then deliver whatever is now in order.
+//	Anything else is a duplicate; it still gets acknowledged (by
+//	the caller), in case the other end didn't hear our last ACK.
+//
+//	Called with the lock held.
+//
+//	"seq" -- the segment's number
+//	"time" -- when the other end sent it, to echo back
+//	"data", "size" -- its data
+//----------------------------------------------------------------------
+
+void
+Transport::GotData(unsigned seq, int time, char *data, int size)
+{
+    echoTime = time;
+    if (seq - recvNext >= (unsigned)windowSize) {
+	DEBUG(dbgNet, "Dropping duplicate segment " << seq);
+	return;
+    }
+    if (recvWindow[seq % windowSize] == NULL) {
+	recvWindow[seq % windowSize] = new Segment(data, size);
+    }
+    if (seq == recvNext) {
+	while (recvWindow[recvNext % windowSize] != NULL) {
+	    delivered->Append(recvWindow[recvNext % windowSize]);
+	    recvWindow[recvNext % windowSize] = NULL;
+	    recvNext++;
+	}
+	dataAvailable->Broadcast(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::ReceiveHelper
+//	Take segments out of the connection's mailbox as they arrive,
+//	process the acknowledgement each one carries, and acknowledge
+//	the ones with data.  Mail from anyone but the other end is
+//	thrown away.
+//
+//	"arg" -- the connection
+//----------------------------------------------------------------------
+
+void
+Transport::ReceiveHelper(void *arg)
+{
+    Transport *_this = (Transport *)arg;
+    Mail *mail;
+    SegmentHeader segHdr, ackHdr;
+    int size;
+
+    for (;;) {
+	mail = kernel->postOfficeIn->ReceiveMail(_this->local);
+	if (mail->pktHdr.from != _this->remote 
+		|| mail->mailHdr.from != _this->remoteBox
+		|| mail->mailHdr.length < sizeof(SegmentHeader)
+		|| mail->mailHdr.length > MaxMailSize) {
+	    mail->Release();
+	    continue;
+	}
+	segHdr = *(SegmentHeader *)mail->data;
+	size = mail->mailHdr.length - sizeof(SegmentHeader);
+
+	_this->lock->Acquire();
+	_this->GotAck(segHdr.ack, segHdr.echo);
+	if (size > 0) {
+	    _this->GotData(segHdr.seq, segHdr.time,
+				mail->data + sizeof(SegmentHeader), size);
+	    ackHdr = _this->MakeHeader(_this->nextSeq, 
+	    				kernel->stats->totalTicks);
+	}
+	_this->lock->Release();
+	mail->Release();
+
+	if (size > 0) {
+	    _this->SendSegment(ackHdr, NULL, 0);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::TimerHelper
+//	Whenever segments are outstanding, sleep until the oldest one is
+//	due to be acknowledged.  If it hasn't been by then, send it again,
+//	and double the timeout in case the network is congested (the
+//	next round trip measurement brings it back down).
+//
+//	"arg" -- the connection
+//----------------------------------------------------------------------
+
+void
+Transport::TimerHelper(void *arg)
+{
+    Transport *_this = (Transport *)arg;
+    int wait;
+
+    _this->lock->Acquire();
+    for (;;) {
+	while (_this->sendBase == _this->nextSeq) {
+	    _this->outstanding->Wait(_this->lock);
+	}
+	wait = _this->timerStart + _this->retransmitTime
+					- kernel->stats->totalTicks;
+	if (wait > 0) {
+	    _this->lock->Release();
+	    kernel->alarm->WaitUntil(wait);
+	    _this->lock->Acquire();
+	} else {
+	    _this->retransmitTime = min(2 * _this->retransmitTime,
+						MaxRetransmitTime);
+	    _this->Retransmit();
+	}
+    }
+}
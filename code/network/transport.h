@@ -0,0 +1,161 @@
+// transport.h
+//	Data structures for reliable, ordered delivery of a stream of bytes
+//	between two mailboxes on different machines, on top of the
+//	unreliable post office.
+//
+//	The sender breaks the stream into segments that each fit in one
+//	packet, and numbers them.  The receiver acknowledges the segments
+//	it has, by sending back the number of the next one it is missing
+//	(a "cumulative" ACK).  Up to "window" segments can be on their way
+//	at once, so the sender doesn't have to wait a round trip for each
+//	one; the link stays busy.
+//
+//	Every segment carries the time it was sent, and every ACK echoes
+//	the time of the segment that caused it (as in TCP's timestamp
+//	option).  That gives a round trip time measurement per ACK, and,
+//	since the network never reorders packets, it also shows exactly
+//	which segments were lost: if the receiver has heard a segment
+//	that was sent after the oldest unacknowledged one, but still
+//	wants that one, it was lost, and is sent again right away.
+//	Segments at the end of the stream, with nothing sent after them,
+//	are sent again if they go unacknowledged for too long; that
+//	timeout adapts to the measured round trip time, as in TCP.  The
+//	receiver keeps segments that arrive out of order, as long as
+//	they fit in the window.
+//
+//	Both ends must use the same window size.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "list.h"
+#include "stats.h"
+#include "post.h"
+#include "synch.h"
+
+// The following class defines the transport header, which is prepended
+// to each segment's data before it is handed to the post office.  A
+// segment with no data is just an acknowledgement.
+
+class SegmentHeader {
+  public:
+    unsigned seq;		// Number of this segment
+    unsigned ack;		// Number of the next segment the sender of
+				// this one is waiting for
+    int time;			// When this segment was sent, by the 
+				// sender's clock
+    int echo;			// "time" of the latest segment the sender
+				// of this one received, or 0
+};
+
+// Most data that can be carried in one segment, so that a segment is
+// never fragmented by the post office
+
+#define MaxSegmentSize	(MaxMailSize - sizeof(SegmentHeader))
+
+// The retransmission timeout, in ticks: where it starts, before any
+// round trip has been measured, and how far it can go.  An idle Nachos
+// machine skips straight from one network poll to the next, so its
+// clock runs fast while it waits for the other machine, and round 
+// trips can come to many more ticks than the packets themselves take.
+
+#define InitialRetransmitTime	(1000 * NetworkTime)
+#define MinRetransmitTime	(4 * NetworkTime)
+#define MaxRetransmitTime	(100000 * NetworkTime)
+
+// A segment that has been sent or received, but not yet acknowledged
+// or delivered.
+
+class Segment {
+  public:
+    Segment(char *segData, int segSize);
+    ~Segment() { delete [] data; }
+
+    char *data;			// the bytes carried by this segment
+    int size;			// how many of them
+    int sentAt;			// when it was last sent, in ticks
+};
+
+// The following class defines one end of a reliable connection.
+// Both ends agree on the machine and mailbox of the other end; each
+// end receives everything -- data and acknowledgements -- in its
+// own mailbox.
+//
+// A connection lasts until Nachos halts: its helper threads never
+// finish, so it can't be deleted.
+
+class Transport {
+  public:
+    Transport(MailBoxAddress localBox, NetworkAddress remoteHost,
+		MailBoxAddress remoteBox, int window);
+				// Open a connection to a remote mailbox
+
+    void Send(char *data, int size);
+				// Send "size" bytes, waiting while the
+				// window is full
+    int Receive(char *data, int size);
+				// Wait for data to arrive, and copy up to
+				// "size" bytes of it into "data"; return
+				// how many
+    void Flush();		// Wait until everything sent has been
+				// acknowledged
+
+    int NumSent() { return numSent; }
+    int NumRetransmitted() { return numRetransmitted; }
+
+  private:
+    MailBoxAddress local;	// our mailbox
+    NetworkAddress remote;	// the other end's machine
+    MailBoxAddress remoteBox;	// the other end's mailbox
+    int windowSize;		// most segments outstanding at once
+
+    Lock *lock;			// protects everything below
+
+    // sending side
+    Segment **sendWindow;	// unacknowledged segments, by seq % window
+    unsigned sendBase;		// oldest unacknowledged segment
+    unsigned nextSeq;		// number for the next new segment
+    int timerStart;		// when the retransmission timer started
+    int smoothedRTT;		// round trip time estimate, in ticks
+    int rttVariance;		// how much the round trip time varies
+    int retransmitTime;		// current retransmission timeout
+    Condition *windowOpen;	// signalled when segments are ACK'ed
+    Condition *outstanding;	// signalled when segments are sent
+    int numSent;		// segments sent, counting retransmissions
+    int numRetransmitted;	// segments sent again
+
+    // receiving side
+    Segment **recvWindow;	// segments that arrived early,
+				// by seq % window
+    unsigned recvNext;		// next segment to deliver
+    int echoTime;		// "time" of the last segment received
+    List<Segment *> *delivered;	// in-order segments not yet Received
+    int deliveredOffset;	// bytes of the first one already Received
+    Condition *dataAvailable;	// signalled when segments are delivered
+
+    SegmentHeader MakeHeader(unsigned seq, int time);
+    				// Header for a segment, with the 
+				// current ACK; called with the lock held
+    void SendSegment(SegmentHeader segHdr, char *data, int size);
+				// Put a segment on the network
+    void Retransmit();		// Send sendBase again
+    void GotAck(unsigned ack, int echo);
+				// Handle an acknowledgement
+    void GotData(unsigned seq, int time, char *data, int size);
+				// Handle an arriving segment
+    void SampleRTT(int rtt);	// Update the retransmission timeout
+
+    static void ReceiveHelper(void *arg);
+				// Thread that takes in segments and ACKs
+    static void TimerHelper(void *arg);
+				// Thread that retransmits when the oldest
+				// segment has been outstanding too long
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,23 @@
+/* echo.c
+ *	Simple program to test reading from the console.
+ *
+ *	Echo each line typed at the keyboard back to the display, until
+ *	end of input, and exit with the number of lines read.  Try it
+ *	with input from a file, e.g. "-ci input -e echo".
+ */
+
+#include "syscall.h"
+
+char line[80];
+
+int
+main()
+{
+    int lines = 0;
+
+    while (ReadLine(line, sizeof(line)) > 0) {
+	PutString(line);
+	lines++;
+    }
+    Exit(lines);
+}
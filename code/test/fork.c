@@ -0,0 +1,58 @@
+/* fork.c
+ *	Simple program to test user-level threads.
+ *
+ *	Fork a few threads that share the work of adding up the numbers
+ *	0 .. N-1, each yielding now and then, join them, and exit with
+ *	the total, which should be N*(N-1)/2.
+ */
+
+#include "syscall.h"
+
+#define N		1000
+#define NumThreads	4
+
+int partial[NumThreads];
+int next;		/* index for the thread being forked */
+int started = 0;	/* how many threads have taken theirs */
+
+void
+Worker()
+{
+    int me = next;		/* main won't change it until we say so */
+    int i;
+
+    started = me + 1;
+
+    for (i = me; i < N; i += NumThreads) {
+	partial[me] += i;
+	if (i % 100 == 0) {
+	    ThreadYield();
+	}
+    }
+    ThreadExit(me);
+}
+
+int
+main()
+{
+    ThreadId tid[NumThreads];
+    int i, sum = 0;
+
+    for (i = 0; i < NumThreads; i++) {
+	next = i;
+	tid[i] = ThreadFork(Worker);
+	if (tid[i] < 0) {
+	    Exit(-1);
+	}
+	while (started <= i) {		/* we can be preempted anywhere, */
+	    ThreadYield();		/* so wait for it to read "next" */
+	}
+    }
+    for (i = 0; i < NumThreads; i++) {
+	if (ThreadJoin(tid[i]) < 0) {
+	    Exit(-2);
+	}
+	sum += partial[i];
+    }
+    Exit(sum);
+}
@@ -0,0 +1,32 @@
+/* hello.c
+ *	Simple program to test writing to the console.
+ *
+ *	Print a few lines with PutString, each of which should reach the
+ *	display with a single console interrupt, then a line longer than
+ *	the console buffer, which takes one interrupt per buffer full.
+ */
+
+#include "syscall.h"
+
+#define LongLine	600
+
+char line[LongLine + 2];
+
+int
+main()
+{
+    int i;
+
+    PutString("Hello, world!\n");
+    PutString("This line goes out all at once.\n");
+
+    for (i = 0; i < LongLine; i++) {
+	line[i] = 'a' + i % 26;
+    }
+    line[LongLine] = '\n';
+    line[LongLine + 1] = '\0';
+    if (PutString(line) != LongLine + 1) {
+	Exit(-1);
+    }
+    Exit(0);
+}
@@ -0,0 +1,102 @@
+/* mailbench.c
+ *	Measure message throughput between user programs on two Nachos 
+ *	machines.  Start the receiver first, then the sender:
+ *
+ *		nachos -net -m 1 -e mailbench
+ *		nachos -net -m 0 -e mailbench
+ *
+ *	Machine 0 sends ROUNDS batches of BATCH messages to machine 1, 
+ *	then an empty message to say it is done.  Machine 1 takes them 
+ *	in a batch at a time, and replies with how many it got.  Both 
+ *	halt, and the statistics show messages per simulated second.
+ *	Lost messages are simply not counted (try "-n 0.9"), but the 
+ *	empty one must get through.
+ */
+
+#include "syscall.h"
+
+#define ROUNDS	20
+#define BATCH	8
+#define SIZE	100
+#define BOX	0
+
+char data[BATCH][SIZE];
+MailMessage msgs[BATCH];
+char number[12];
+
+void
+PutNumber(int n)
+{
+    int i = sizeof(number) - 1;
+
+    number[i] = '\0';
+    do {
+	number[--i] = '0' + n % 10;
+	n /= 10;
+    } while (n > 0);
+    PutString(&number[i]);
+}
+
+void
+Sender()
+{
+    int i, j, count;
+
+    for (i = 0; i < BATCH; i++) {
+	msgs[i].host = 1;
+	msgs[i].box = BOX;
+	msgs[i].data = data[i];
+	msgs[i].size = SIZE;
+	for (j = 0; j < SIZE; j++) {
+	    data[i][j] = i + j;
+	}
+    }
+    for (i = 0; i < ROUNDS; i++) {
+	SendBatch(msgs, BATCH);
+    }
+    Send(1, BOX, data[0], 0);
+    Receive(BOX, (char *) &count, sizeof(count), 0);
+    PutString("Sent ");
+    PutNumber(ROUNDS * BATCH);
+    PutString(" messages, received ");
+    PutNumber(count);
+    PutString("\n");
+}
+
+void
+Receiver()
+{
+    int i, n, count = 0, done = 0;
+
+    while (!done) {
+	for (i = 0; i < BATCH; i++) {
+	    msgs[i].data = data[i];
+	    msgs[i].size = SIZE;
+	}
+	n = ReceiveBatch(BOX, msgs, BATCH);
+	for (i = 0; i < n; i++) {
+	    if (msgs[i].size == 0) {
+		done = 1;
+	    } else {
+		count++;
+	    }
+	}
+    }
+    Send(msgs[0].host, BOX, (char *) &count, sizeof(count));
+    if (TryReceive(BOX, data[0], SIZE, 0) == NoMessage) {
+	PutString("Received ");
+	PutNumber(count);
+	PutString(" messages\n");
+    }
+}
+
+int
+main()
+{
+    if (HostId() == 0) {
+	Sender();
+    } else {
+	Receiver();
+    }
+    Halt();
+}
@@ -0,0 +1,27 @@
+/* share.c
+ *	Simple program to test proportional-share scheduling.
+ *
+ *	Ask for three times the default number of tickets, then compute
+ *	for a while.  Run it next to another compute-bound program under
+ *	the stride scheduler, e.g. "-sched stride -e share -e matmult", 
+ *	and it should get about three quarters of the CPU, as shown by 
+ *	the user ticks in the statistics printed at the end.
+ */
+
+#include "syscall.h"
+
+#define N	20000
+
+int
+main()
+{
+    int i, sum = 0;
+
+    if (SetTickets(300) < 0) {
+	Exit(-1);
+    }
+    for (i = 0; i < N; i++) {
+	sum += i;
+    }
+    Exit(sum);
+}
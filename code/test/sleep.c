@@ -0,0 +1,24 @@
+/* sleep.c
+ *	Simple program to test the Sleep system call.
+ *
+ *	A periodic task: do a little work, then sleep until the next 
+ *	period, instead of spinning.  Run two copies at once (-e sleep
+ *	-e sleep) to see them take turns.
+ */
+
+#include "syscall.h"
+
+#define PERIOD	1000
+#define ROUNDS	10
+
+int
+main()
+{
+    int i, sum = 0;
+
+    for (i = 0; i < ROUNDS; i++) {
+	sum += i;
+	Sleep(PERIOD);
+    }
+    Exit(sum);
+}
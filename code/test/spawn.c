@@ -0,0 +1,34 @@
+/* spawn.c
+ *	Simple program to test the process system calls.
+ *
+ *	Start a few copies of another program, each in its own process,
+ *	wait for them all to exit, and exit with the sum of their exit
+ *	statuses.  Run as "-e spawn"; each child (share) exits with the
+ *	same sum, so this should return four times that.
+ */
+
+#include "syscall.h"
+
+#define N	4
+
+int
+main()
+{
+    SpaceId child[N];
+    int i, sum;
+
+    for (i = 0; i < N; i++) {
+	child[i] = Exec("share");
+	if (child[i] < 0) {
+	    Exit(-1);
+	}
+    }
+    sum = Join(child[0]);
+    if (sum < 0 || Join(child[0]) >= 0) {
+	Exit(-2);		/* can only Join a child once */
+    }
+    for (i = 1; i < N; i++) {
+	sum += Join(child[i]);
+    }
+    Exit(sum);
+}
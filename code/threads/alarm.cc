@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and putting threads to 
+//	sleep for a while (WaitUntil).
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -18,11 +17,70 @@
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to 
 //		occur at random, instead of fixed, intervals.
+//	"tickless" -- if true, only interrupt when some thread needs
+//		to be preempted or woken up.
+//----------------------------------------------------------------------
+
+Alarm::Alarm(bool doRandom, bool isTickless)
+{
+    tickless = isTickless;
+    randomize = doRandom;
+    wheel = new TimerWheel(0);
+    periodic = FALSE;
+    expected = -1;
+    if (!tickless) {		// else wait until a second thread is ready
+	Enable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::SetInterrupt
+//	Schedule a timer interrupt "delay" ticks from now, and remember
+//	that it is the one that counts.
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom)
+void
+Alarm::SetInterrupt(int delay)
 {
-    timer = new Timer(doRandom, this);
+    kernel->interrupt->Schedule(this, delay, TimerInt);
+    expected = kernel->stats->totalTicks + delay;
+}
+
+//----------------------------------------------------------------------
+// Alarm::Enable
+//	Interrupt every time slice, from now on.  The delay is either
+//	fixed or random, as with the Timer device.  An interrupt that 
+//	is already due within a time slice will do for the first one.
+//----------------------------------------------------------------------
+
+void
+Alarm::Enable()
+{
+    periodic = TRUE;
+    if (expected < 0 || expected > kernel->stats->totalTicks + TimerTicks) {
+	int delay = TimerTicks;
+
+	if (randomize) {
+	    delay = 1 + (RandomNumber() % (TimerTicks * 2));
+	}
+	SetInterrupt(delay);
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Program
+//	Interrupt just once, "delay" ticks from now.  If an interrupt
+//	is already due sooner, that one will do instead.
+//----------------------------------------------------------------------
+
+void
+Alarm::Program(int delay)
+{
+    ASSERT(delay > 0);
+    periodic = FALSE;
+    if (expected < 0 || expected > kernel->stats->totalTicks + delay) {
+	SetInterrupt(delay);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -39,8 +97,14 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	First wake up any threads whose WaitUntil has expired.  Then
+//	time slice, if we're currently running something (in other words,
+//	not idle), and only if the scheduler says the time slice is over.
+//	Last, schedule the next interrupt, if we are still interrupting 
+//	every time slice and Update hasn't done it already.
+//
+//	An interrupt that arrives before the one we are expecting was
+//	superseded by a later call to Enable or Program; ignore it.
 //----------------------------------------------------------------------
 
 void 
@@ -49,7 +113,304 @@ Alarm::CallBack()
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
     
-    if (status != IdleMode) {
+    if (expected < 0 || kernel->stats->totalTicks < expected) {
+	return;
+    }
+    expected = -1;
+
+    wheel->Advance(kernel->stats->totalTicks / TimerTicks);
+
+    if (status != IdleMode && kernel->scheduler->ShouldPreempt()) {
 	interrupt->YieldOnReturn();
     }
+    Update();
+    if (periodic && expected < 0) {
+	Enable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Update
+//	In tickless mode, decide when the timer should next interrupt:
+//	every time slice if some thread is waiting for the CPU, when the
+//	next sleeping thread is due if not, and never if nothing is 
+//	sleeping either.  Called with interrupts disabled, whenever that
+//	might have changed.
+//----------------------------------------------------------------------
+
+void
+Alarm::Update()
+{
+    if (!tickless) {
+	return;
+    }
+    if (kernel->scheduler->NumReady() > 0) {
+	Enable();
+    } else if (wheel->NumSleeping() > 0) {
+	int delay = wheel->NextDue() * TimerTicks - kernel->stats->totalTicks;
+
+	Program(delay > 0 ? delay : 1);
+    } else {
+	Disable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//	Put the current thread to sleep for at least "x" ticks.  It is
+//	woken up by the first timer interrupt at or after that time.
+//
+//	The timer may have been turned off, if at some point nothing 
+//	was left to run (see Kernel::PrepareToEnd), so turn it back on.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *thread = kernel->currentThread;
+    IntStatus oldLevel;
+
+    if (x <= 0) {
+	return;
+    }
+    oldLevel = interrupt->SetLevel(IntOff);
+    DEBUG(dbgThread, "Thread " << thread->getName() << " sleeping for " << x);
+    thread->setWakeTime(kernel->stats->totalTicks + x);
+    wheel->Insert(thread);
+    if (tickless) {
+	Update();
+    } else {
+	Enable();
+    }
+    thread->Sleep(FALSE);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::TimerWheel
+//	Initialize an empty timing wheel.
+//
+//	"now" is the number of the next timer interrupt
+//----------------------------------------------------------------------
+
+TimerWheel::TimerWheel(int now)
+{
+    current = now;
+    numSleeping = 0;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Insert
+//	Put a thread on the wheel, to be woken up at the first timer 
+//	interrupt at or after thread->getWakeTime().
+//
+//	If the wheel is empty, its clock may have fallen behind (Advance
+//	doesn't bother keeping it while nothing is sleeping), so bring 
+//	it up to date first.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Insert(Thread *thread)
+{
+    if (numSleeping == 0) {	// nothing to catch up on
+	int now = kernel->stats->totalTicks / TimerTicks;
+
+	if (current < now) {
+	    current = now;
+	}
+    }
+    Place(thread);
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Place
+//	Put a thread in the slot for the timer interrupt it is due at,
+//	counting from "current", the next one Advance will process.  The
+//	slot is chosen by how far off that is: the sooner it is due, the
+//	lower the level.  Unlike Insert, this leaves "current" alone, so
+//	Advance and Cascade can use it partway through a pass.
+//
+//	If the wait is too long for the wheel, park the thread in the 
+//	farthest slot; Advance will put it back when it comes around.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Place(Thread *thread)
+{
+    int due = (thread->getWakeTime() + TimerTicks - 1) / TimerTicks;
+    int level;
+
+    if (due < current) {
+	due = current;
+    }
+    if (due - current >= (1 << (WheelBits * WheelLevels))) {
+	due = current + (1 << (WheelBits * WheelLevels)) - 1;
+    }
+    for (level = 0; level < WheelLevels - 1; level++) {
+	if (due - current < (1 << (WheelBits * (level + 1)))) {
+	    break;
+	}
+    }
+    slot[level][(due >> (WheelBits * level)) & WheelMask].Append(thread);
+    numSleeping++;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Cascade
+//	Move the threads in one slot down towards level 0, now that
+//	they are close to being due.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Cascade(int level, int index)
+{
+    ThreadQueue *queue = &slot[level][index];
+
+    while (!queue->IsEmpty()) {
+	numSleeping--;
+	Place(queue->RemoveFront());
+    }
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::NextDue
+//	Return the next timer interrupt at which Advance might have
+//	something to do: either a level 0 slot with threads in it, or
+//	the next time a slot from the upper levels is spread out over 
+//	level 0, whichever comes first.  At most one revolution of 
+//	level 0 is searched.
+//----------------------------------------------------------------------
+
+int
+TimerWheel::NextDue()
+{
+    int next;
+
+    for (next = current; (next & WheelMask) != 0 || next == current; next++) {
+	if (!slot[0][next & WheelMask].IsEmpty()) {
+	    return next;
+	}
+    }
+    return next;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Advance
+//	Move the wheel forward to timer interrupt "now", waking up 
+//	the threads in each level 0 slot we pass.  Every WheelSlots 
+//	interrupts, a slot at level 1 is due to be spread out over 
+//	level 0; every WheelSlots^2, one at level 2; and so on.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Advance(int now)
+{
+    if (numSleeping == 0) {	// nothing to do, just keep the time
+	if (current <= now) {
+	    current = now + 1;
+	}
+	return;
+    }
+    for (; current <= now; current++) {
+	int index = current & WheelMask;
+	ThreadQueue *queue = &slot[0][index];
+
+	for (int level = 1; index == 0 && level < WheelLevels; level++) {
+	    index = (current >> (WheelBits * level)) & WheelMask;
+	    Cascade(level, index);
+	}
+	while (!queue->IsEmpty()) {
+	    Thread *thread = queue->RemoveFront();
+
+	    numSleeping--;
+	    if (thread->getWakeTime() > kernel->stats->totalTicks) {
+		Place(thread);		// parked; not really due yet
+	    } else {
+		DEBUG(dbgThread, "Waking up thread " << thread->getName());
+		kernel->scheduler->ReadyToRun(thread);
+	    }
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::SelfTest, SelfTestHelper, BoundaryTestHelper
+// 	Test WaitUntil, by putting threads to sleep for assorted lengths
+//	of time -- some short enough for level 0 of the wheel, some long
+//	enough to cascade down from the upper levels -- and checking
+//	that each one wakes up no sooner than asked, and in order.
+//	Then check that a thread due just as it cascades down to level 0
+//	wakes up no later than it should, either.  Run it with -rs too.
+//----------------------------------------------------------------------
+
+static const int NumSleepers = 6;
+static int sleepTime[NumSleepers] = { 50, 300, 7000, 700000, 150, 1 };
+static int lastWoken;		// timer interrupt the latest thread was due
+static int numWoken;
+
+static void
+SelfTestHelper(int *delay)
+{
+    // keep interrupts off, so that once woken up, we check before 
+    // anyone woken up after us can (-rs would otherwise preempt us)
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    int start = kernel->stats->totalTicks;
+    int due;
+
+    kernel->alarm->WaitUntil(*delay);
+    ASSERT(kernel->stats->totalTicks >= start + *delay);
+    due = (kernel->currentThread->getWakeTime() + TimerTicks - 1) / TimerTicks;
+    ASSERT(due >= lastWoken);
+    lastWoken = due;
+    numWoken++;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+static const int BoundaryRounds = 8;
+
+static void
+BoundaryTestHelper(void *unused)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    int now = kernel->stats->totalTicks;
+    int due = (now / TimerTicks / WheelSlots + 2) * WheelSlots;
+
+    kernel->alarm->WaitUntil(due * TimerTicks - now);
+    ASSERT(kernel->stats->totalTicks >= due * TimerTicks);
+    ASSERT(kernel->stats->totalTicks < (due + 4) * TimerTicks);
+    numWoken++;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+void
+Alarm::SelfTest()
+{
+    lastWoken = 0;
+    numWoken = 0;
+    for (int i = 0; i < NumSleepers; i++) {
+	Thread *t = new Thread("sleeper", i + 1);
+
+	t->Fork((VoidFunctionPtr) SelfTestHelper, &sleepTime[i]);
+    }
+    while (numWoken < NumSleepers) {
+	WaitUntil(100 * TimerTicks);
+    }
+    ASSERT(!AnySleeping());
+
+    // a lone sleeper, due exactly when a level 1 slot is spread out
+    // over level 0, must still wake up on time -- even if (with -rs)
+    // the interrupt for that boundary is skipped over
+    for (int i = 0; i < BoundaryRounds; i++) {
+	Thread *t = new Thread("boundary sleeper", 1);
+
+	numWoken = 0;
+	t->Fork((VoidFunctionPtr) BoundaryTestHelper, NULL);
+	while (numWoken == 0) {		// stay off the wheel ourselves
+	    kernel->currentThread->Yield();
+	}
+    }
+    ASSERT(!AnySleeping());
 }
@@ -8,7 +8,21 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	Sleeping threads are kept on a hierarchical timing wheel, so
+//	that putting a thread to sleep, and waking it up, take constant
+//	time no matter how many threads are sleeping.
+//
+//	In "tickless" mode, the timer only interrupts every time slice
+//	while there is another thread ready to take over the CPU.  
+//	Otherwise, it is programmed to go off when the next sleeping 
+//	thread is due, or not at all, so that the machine can idle
+//	straight through to the next interrupt that matters.
+//
+//	The Timer device can only interrupt periodically, and once it 
+//	has been disabled it stays off, so the alarm clock schedules 
+//	its own timer interrupts instead.  Since a scheduled interrupt 
+//	can't be taken back, one that has been superseded by a later
+//	decision is simply ignored when it arrives.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,22 +34,78 @@
 #include "copyright.h"
 #include "utility.h"
 #include "callback.h"
-#include "timer.h"
+#include "thread.h"
+
+// The timing wheel is made up of WheelLevels levels of WheelSlots
+// slots each.  A slot at level 0 holds the threads due to wake up
+// at one particular timer interrupt; a slot at level n covers
+// WheelSlots times as much time as a slot at level n-1.  As time
+// passes, the threads in a slot at level n are spread out over
+// level n-1, shortly before they are due (this is the same scheme
+// as the classic UNIX callout wheel).  Four levels of 64 slots cover
+// 2^24 timer interrupts; longer waits just go around the top level
+// more than once.
+
+const int WheelBits = 6;
+const int WheelSlots = (1 << WheelBits);
+const int WheelMask = (WheelSlots - 1);
+const int WheelLevels = 4;
+
+class TimerWheel {
+  public:
+    TimerWheel(int now);	// Initialize an empty wheel, whose
+				// clock reads "now" timer interrupts
+    
+    void Insert(Thread *thread);// Sleep until thread->getWakeTime()
+    void Advance(int now);	// Wake up every thread that is due 
+				// by timer interrupt "now"
+    int NextDue();		// The next timer interrupt at which a
+				// thread might be due
+    int NumSleeping() { return numSleeping; }
+
+  private:
+    ThreadQueue slot[WheelLevels][WheelSlots];
+    int current;		// the next timer interrupt to process
+    int numSleeping;		// number of threads on the wheel
+
+    void Place(Thread *thread);	// Put a thread in its slot, counting
+				// from "current"
+    void Cascade(int level, int index);
+    				// Re-insert the threads in a slot, 
+				// at the next level down
+};
 
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
+    Alarm(bool doRandomYield, bool tickless);
+    				// Initialize the timer, and callback 
 				// to "toCall" every time slice.
-    ~Alarm() { delete timer; }
+    ~Alarm() { delete wheel; }
     
     void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
+    bool AnySleeping() { return wheel->NumSleeping() > 0; }
+    				// is a thread waiting in WaitUntil?
+    void Update();		// Reprogram the timer for what is
+				// ready and sleeping now (tickless only)
 	
-	void Disable() { timer->Disable(); } //2015.11.25
+	void Disable() { periodic = FALSE; } //2015.11.25
+
+    void SelfTest();		// test WaitUntil
 
   private:
-    Timer *timer;		// the hardware timer device
+    TimerWheel *wheel;		// threads waiting in WaitUntil
+    bool tickless;		// only interrupt when there's a reason to
+    bool randomize;		// interrupt at random, instead of fixed,
+				// intervals?
+    bool periodic;		// interrupt every time slice?
+    int expected;		// when the next timer interrupt is due,
+				// -1 if none is scheduled
+
+    void Enable();		// interrupt every time slice from now on
+    void Program(int delay);	// interrupt once, "delay" ticks from now
+    void SetInterrupt(int delay);
+    				// schedule a timer interrupt
 
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
@@ -15,8 +15,12 @@
 #include "libtest.h"
 #include "string.h"
 #include "synchdisk.h"
+#include "diskarray.h"
 #include "post.h"
+#include "transport.h"
+#include "netdisk.h"
 #include "synchconsole.h"
+#include "process.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -27,6 +31,10 @@
 Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE;
+    tickless = FALSE;
+    schedulerType = SchedFIFO;
+    schedReport = FALSE;
+    minQuantum = maxQuantum = 0;
     debugUserProg = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
@@ -36,9 +44,15 @@ Kernel::Kernel(int argc, char **argv)
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
+    networkFlag = FALSE;
+    diskServerFlag = FALSE;
+    diskHost = -1;		// use our own disk
+    diskWindow = 1;
+    stripeDisks = 0;
+    mirrorDisks = FALSE;
 
-	// MP4 mod tag
-	execfileNum = 0; // dummy operation to keep valgrind happy
+	execfile = new char*[argc];	// can't be more than this
+	execfileNum = 0;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
@@ -47,11 +61,37 @@ Kernel::Kernel(int argc, char **argv)
 			// number generator
 	    	randomSlice = TRUE;
 	    	i++;
+        } else if (strcmp(argv[i], "-tickless") == 0) {
+	    	tickless = TRUE;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-sched") == 0) {
+	    	ASSERT(i + 1 < argc);
+	    	if (strcmp(argv[i + 1], "fifo") == 0) {
+	    	    schedulerType = SchedFIFO;
+	    	} else if (strcmp(argv[i + 1], "mlfq") == 0) {
+	    	    schedulerType = SchedMLFQ;
+	    	} else if (strcmp(argv[i + 1], "prio") == 0) {
+	    	    schedulerType = SchedPriority;
+	    	} else if (strcmp(argv[i + 1], "stride") == 0) {
+	    	    schedulerType = SchedStride;
+	    	} else {
+	    	    cerr << "Unknown scheduler " << argv[i + 1] << "\n";
+	    	    ASSERTNOTREACHED();
+	    	}
+	    	schedReport = TRUE;	// report on the policy we asked for
+	    	i++;
+        } else if (strcmp(argv[i], "-quantum") == 0) {
+	    	ASSERT(i + 2 < argc);
+	    	minQuantum = atoi(argv[i + 1]);
+	    	maxQuantum = atoi(argv[i + 2]);
+	    	ASSERT(0 < minQuantum && minQuantum <= maxQuantum);
+	    	schedReport = TRUE;
+	    	i += 2;
 		} else if (strcmp(argv[i], "-e") == 0) {
-        	execfile[++execfileNum]= argv[++i];
-			cout << execfile[execfileNum] << "\n";
+	    	ASSERT(i + 1 < argc);
+        	execfile[execfileNum++] = argv[++i];
+			cout << argv[i] << "\n";
 		} else if (strcmp(argv[i], "-ci") == 0) {
 	    	ASSERT(i + 1 < argc);
 	    	consoleIn = argv[i + 1];
@@ -72,14 +112,43 @@ Kernel::Kernel(int argc, char **argv)
             ASSERT(i + 1 < argc);   // next argument is int
             hostName = atoi(argv[i + 1]);
             i++;
+        } else if (strcmp(argv[i], "-N") == 0 || 
+				strcmp(argv[i], "-NB") == 0 ||
+				strcmp(argv[i], "-NR") == 0 ||
+				strcmp(argv[i], "-NC") == 0) {
+            networkFlag = TRUE;		// the test itself is run from main
+        } else if (strcmp(argv[i], "-net") == 0) {
+            networkFlag = TRUE;		// for user programs' messages
+        } else if (strcmp(argv[i], "-raid") == 0) {
+            ASSERT(i + 1 < argc);	// number of disks
+            stripeDisks = atoi(argv[i + 1]);
+            ASSERT(0 < stripeDisks && stripeDisks <= MaxStripeDisks);
+            i++;
+        } else if (strcmp(argv[i], "-mirror") == 0) {
+            mirrorDisks = TRUE;
+        } else if (strcmp(argv[i], "-ds") == 0) {
+            diskServerFlag = TRUE;	// serve our disk
+            networkFlag = TRUE;
+        } else if (strcmp(argv[i], "-rd") == 0) {
+            ASSERT(i + 2 < argc);	// server, then window size
+            diskHost = atoi(argv[i + 1]);
+            diskWindow = atoi(argv[i + 2]);
+            ASSERT(diskWindow > 0);
+            networkFlag = TRUE;
+            i += 2;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
 	   		cout << "Partial usage: nachos [-s]\n";
+	   		cout << "Partial usage: nachos [-tickless]\n";
+	   		cout << "Partial usage: nachos [-sched fifo|mlfq|prio|stride]\n";
+	   		cout << "Partial usage: nachos [-quantum minTicks maxTicks]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
 #endif
-            cout << "Partial usage: nachos [-n #] [-m #]\n";
+            cout << "Partial usage: nachos [-n #] [-m #] [-net]\n";
+            cout << "Partial usage: nachos [-ds] [-rd host window]\n";
+            cout << "Partial usage: nachos [-raid disks] [-mirror]\n";
 		}
     }
 }
@@ -99,44 +168,77 @@ Kernel::Initialize()
     // object to save its state.
 
 
-    currentThread = new Thread("main", threadNum++);
+    currentThread = new Thread("main", 0);
     currentThread->setStatus(RUNNING);
+    currentThread->setArrivalTime(0);	// running since time 0
+    currentThread->setFirstRunTime(0);
 
     stats = new Statistics();		// collect statistics
     interrupt = new Interrupt;		// start up interrupt handling
-    scheduler = new Scheduler();	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
+    scheduler = new Scheduler(schedulerType);	// initialize the ready queue
+    if (schedReport) {
+	scheduler->EnableReport();
+    }
+    if (minQuantum > 0) {
+	scheduler->SetQuantumBounds(minQuantum, maxQuantum);
+    }
+    alarm = new Alarm(randomSlice, tickless);	// start up time slicing
     machine = new Machine(debugUserProg);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
-    synchDisk = new SynchDisk();    //
+
+    // the network is polled for packets forever, so only bring it up
+    // when it will be used; the disk may be on another machine, so
+    // it comes first
+    if (networkFlag) {
+	postOfficeIn = new PostOfficeInput(10);
+	postOfficeOut = new PostOfficeOutput(reliability);
+    } else {
+	postOfficeIn = NULL;
+	postOfficeOut = NULL;
+    }
+
+    if (diskHost >= 0) {
+	synchDisk = new NetworkDisk(diskHost, diskWindow);
+    } else if (stripeDisks > 0 || mirrorDisks) {
+#ifdef FILESYS_STUB			// nothing ever formats the disk
+	synchDisk = new DiskArray(max(stripeDisks, 1), mirrorDisks, FALSE);
+#else
+	synchDisk = new DiskArray(max(stripeDisks, 1), mirrorDisks,
+					formatFlag);
+#endif
+    } else {
+	synchDisk = new SynchDisk();
+    }
+    if (diskServerFlag) {
+	(void) new DiskServer(synchDisk);	// runs until we halt
+    }
+    processTable = new ProcessTable();
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
     fileSystem = new FileSystem(formatFlag);
 #endif // FILESYS_STUB
 
-	// MP4 mod tag
-    /*
-	postOfficeIn = new PostOfficeInput(10);
-    postOfficeOut = new PostOfficeOutput(reliability);
-	*/
-
     interrupt->Enable();
 }
 
 //----------------------------------------------------------------------
 //	MP4 mod tag
 //	Kernel::PrepareToEnd
-// 	Since Nachos does not disable Timer, Console after all threads complete,
+// 	Since Nachos does not disable Timer after all threads complete,
 //	which will result in generating infinite interrupts. We manually disable timer,
-//	console, etc. after all threads complete.
+//	etc. after all threads complete.  The timer is left on
+//	while a thread is sleeping in Alarm::WaitUntil, since it is the
+//	timer that will wake it up.  The console only interrupts while 
+//	someone is waiting for input, so it needn't be disabled.
 //----------------------------------------------------------------------
 void
 Kernel::PrepareToEnd()
 {
-	alarm->Disable();
-	synchConsoleIn->Disable();
+	if (!alarm->AnySleeping()) {
+		alarm->Disable();
+	}
 }
 
 //----------------------------------------------------------------------
@@ -154,20 +256,108 @@ Kernel::~Kernel()
     delete synchConsoleIn;
     delete synchConsoleOut;
     delete synchDisk;
+    delete processTable;
     delete fileSystem;
+    delete [] execfile;
 
-	// Mp4 mod tag
-	/*
     delete postOfficeIn;
     delete postOfficeOut;
-    */
 
     Exit(0);
 }
 
+//----------------------------------------------------------------------
+// SynchBenchmark
+//      Measure the host time spent on synchronization:
+//	1. a lock that is never contended;
+//	2. two threads handing control back and forth with semaphores;
+//	3. the same, with a lock and a condition variable.
+//	None of these should need to allocate memory.
+//----------------------------------------------------------------------
+
+static const int BenchLocks = 200000;	// lock acquire/release pairs
+static const int BenchHandoffs = 20000;	// round trips between threads
+static Semaphore *benchPing, *benchPong;
+static Lock *benchLock;
+static Condition *benchCond;
+static int benchTurn;			// whose turn it is, 0 or 1
+
+static void
+BenchSemaphoreThread()
+{
+    for (int i = 0; i < BenchHandoffs; i++) {
+	benchPing->P();
+	benchPong->V();
+    }
+}
+
+static void
+BenchConditionThread()
+{
+    benchLock->Acquire();
+    for (int i = 0; i < BenchHandoffs; i++) {
+	while (benchTurn != 1) {
+	    benchCond->Wait(benchLock);
+	}
+	benchTurn = 0;
+	benchCond->Signal(benchLock);
+    }
+    benchLock->Release();
+}
+
+static void
+SynchBenchmark()
+{
+    Thread *t;
+    double start;
+
+    benchLock = new Lock("bench");
+    start = HostTime();
+    for (int i = 0; i < BenchLocks; i++) {
+	benchLock->Acquire();
+	benchLock->Release();
+    }
+    cout << "Lock benchmark: " << BenchLocks << " acquire/release pairs, "
+	 << ((HostTime() - start) * 1e9) / BenchLocks << " ns per pair\n";
+
+    benchPing = new Semaphore("ping", 0);
+    benchPong = new Semaphore("pong", 0);
+    t = new Thread("bench", 1);
+    t->Fork((VoidFunctionPtr) BenchSemaphoreThread, NULL);
+    start = HostTime();
+    for (int i = 0; i < BenchHandoffs; i++) {
+	benchPing->V();
+	benchPong->P();
+    }
+    cout << "Semaphore benchmark: " << BenchHandoffs << " round trips, "
+	 << ((HostTime() - start) * 1e9) / BenchHandoffs << " ns per round trip\n";
+    delete benchPing;
+    delete benchPong;
+
+    benchCond = new Condition("bench");
+    benchTurn = 0;
+    t = new Thread("bench", 1);
+    t->Fork((VoidFunctionPtr) BenchConditionThread, NULL);
+    start = HostTime();
+    benchLock->Acquire();
+    for (int i = 0; i < BenchHandoffs; i++) {
+	benchTurn = 1;
+	benchCond->Signal(benchLock);
+	while (benchTurn != 0) {
+	    benchCond->Wait(benchLock);
+	}
+    }
+    benchLock->Release();
+    cout << "Condition benchmark: " << BenchHandoffs << " round trips, "
+	 << ((HostTime() - start) * 1e9) / BenchHandoffs << " ns per round trip\n";
+    delete benchCond;
+    delete benchLock;
+}
+
 //----------------------------------------------------------------------
 // Kernel::ThreadSelfTest
-//      Test threads, semaphores, synchlists
+//      Test threads, semaphores, synchlists, and time the
+//	synchronization primitives
 //----------------------------------------------------------------------
 
 void
@@ -190,6 +380,79 @@ Kernel::ThreadSelfTest() {
    synchList->SelfTest(9);
    delete synchList;
 
+   SynchBenchmark();		// time locks, semaphores, conditions
+
+   alarm->SelfTest();		// test sleeping on the alarm clock
+
+}
+
+//----------------------------------------------------------------------
+// Kernel::ThreadBenchmark
+//      Measure the host time spent on thread operations:
+//	1. scheduling, by forking many threads at assorted priorities
+//	   that do nothing but yield to each other;
+//	2. thread creation, by forking short-lived threads one at a
+//	   time, and letting each one run to completion.
+//----------------------------------------------------------------------
+
+static const int BenchThreads = 2000;	// number of threads to fork
+static const int BenchYields = 10;	// times each thread yields
+static const int BenchForks = 20000;	// number of short-lived threads
+static int benchDone;			// number of threads finished
+
+static void
+BenchExitThread()
+{
+    benchDone++;
+}
+
+static void
+BenchYieldThread()
+{
+    for (int i = 0; i < BenchYields; i++) {
+	kernel->currentThread->Yield();
+    }
+    benchDone++;
+}
+
+void
+Kernel::ThreadBenchmark() {
+    int switches = scheduler->NumSwitches();
+    double start = HostTime();
+    double elapsed;
+
+    benchDone = 0;
+    for (int i = 0; i < BenchThreads; i++) {
+	Thread *t = new Thread("bench", i + 1);
+
+	t->SetPriority(i % NumPriorities);
+	t->Fork((VoidFunctionPtr) BenchYieldThread, NULL);
+    }
+    while (benchDone < BenchThreads) {
+	currentThread->Yield();
+    }
+    elapsed = HostTime() - start;
+    switches = scheduler->NumSwitches() - switches;
+
+    cout << "Scheduler benchmark: " << BenchThreads << " threads, "
+	 << switches << " context switches, "
+	 << (elapsed * 1e9) / switches << " ns per switch\n";
+
+    benchDone = 0;
+    start = HostTime();
+    for (int i = 0; i < BenchForks; i++) {
+	Thread *t = new Thread("bench", i + 1);
+
+	t->Fork((VoidFunctionPtr) BenchExitThread, NULL);
+	currentThread->Yield();		// let it run and finish
+    }
+    while (benchDone < BenchForks) {
+	currentThread->Yield();
+    }
+    elapsed = HostTime() - start;
+
+    cout << "Fork/exit benchmark: " << BenchForks << " threads, "
+	 << (elapsed * 1e9) / BenchForks << " ns per fork and exit\n";
 }
 
 //----------------------------------------------------------------------
@@ -252,7 +515,8 @@ Kernel::NetworkTest() {
         postOfficeOut->Send(outPktHdr, outMailHdr, data);
 
         // Wait for the first message from the other machine
-        postOfficeIn->Receive(0, &inPktHdr, &inMailHdr, buffer);
+        postOfficeIn->Receive(0, &inPktHdr, &inMailHdr, buffer, 
+							MaxMailSize);
         cout << "Got: " << buffer << " : from " << inPktHdr.from << ", box "
                                                 << inMailHdr.from << "\n";
         cout.flush();
@@ -265,7 +529,8 @@ Kernel::NetworkTest() {
         postOfficeOut->Send(outPktHdr, outMailHdr, ack);
 
         // Wait for the ack from the other machine to the first message we sent
-	postOfficeIn->Receive(1, &inPktHdr, &inMailHdr, buffer);
+	postOfficeIn->Receive(1, &inPktHdr, &inMailHdr, buffer, 
+							MaxMailSize);
         cout << "Got: " << buffer << " : from " << inPktHdr.from << ", box "
                                                 << inMailHdr.from << "\n";
         cout.flush();
@@ -274,59 +539,543 @@ Kernel::NetworkTest() {
     // Then we're done!
 }
 
-void ForkExecute(Thread *t)
-{
-	if ( !t->space->Load(t->getName()) ) {
-    	return;             // executable not found
+//----------------------------------------------------------------------
+// Kernel::NetworkBulkTest
+//      Measure how fast the post office moves large messages.  Machine
+//	#0 sends BulkMessages messages of "size" bytes each to mailbox #0
+//	on machine #1, which checks that each arrived intact and then
+//	acknowledges the lot to mailbox #1 on machine #0.  Both report 
+//	the simulated and host time it took, and then halt.
+//
+//	Nothing is retransmitted, so run this with a reliable network.
+//	Start machine #1 first; its times include waiting for machine #0
+//	to get going, so machine #0's figures are the ones to go by.
+//
+//	"size" -- bytes in each message
+//----------------------------------------------------------------------
+
+static const int BulkMessages = 20;	// messages sent in a bulk test
+
+void
+Kernel::NetworkBulkTest(int size) {
+    PacketHeader outPktHdr, inPktHdr;
+    MailHeader outMailHdr, inMailHdr;
+    char *data = new char[size];
+    char ack[MaxMailSize];
+    int packets = stats->numPacketsSent + stats->numPacketsRecvd;
+    int startTicks = stats->totalTicks;
+    double start = HostTime();
+    double elapsed;
+    int ticks;
+
+    ASSERT(size > 0);
+    ASSERT(hostName == 0 || hostName == 1);
+
+    if (hostName == 0) {
+	for (int i = 0; i < size; i++) {
+	    data[i] = (char) i;
+	}
+	outPktHdr.to = 1;
+	outMailHdr.to = 0;
+	outMailHdr.from = 1;
+	outMailHdr.length = size;
+	for (int i = 0; i < BulkMessages; i++) {
+	    postOfficeOut->Send(outPktHdr, outMailHdr, data);
+	}
+	postOfficeIn->Receive(1, &inPktHdr, &inMailHdr, ack, MaxMailSize);
+    } else {
+	for (int i = 0; i < BulkMessages; i++) {
+	    postOfficeIn->Receive(0, &inPktHdr, &inMailHdr, data, size);
+	    ASSERT(inMailHdr.length == (unsigned)size);
+	    for (int j = 0; j < size; j++) {
+		ASSERT(data[j] == (char) j);
+	    }
+	}
+	outPktHdr.to = inPktHdr.from;
+	outMailHdr.to = inMailHdr.from;
+	outMailHdr.from = 0;
+	outMailHdr.length = 1;
+	ack[0] = '\0';
+	postOfficeOut->Send(outPktHdr, outMailHdr, ack);
     }
+    elapsed = HostTime() - start;
+    ticks = stats->totalTicks - startTicks;
+    packets = stats->numPacketsSent + stats->numPacketsRecvd - packets;
 
-    t->space->Execute(t->getName());
+    cout << "Bulk transfer: " << BulkMessages << " messages of " << size 
+	 << " bytes, " << packets << " packets, "
+	 << ticks << " ticks, "
+	 << (BulkMessages * (double) size * 1000) / ticks 
+	 << " bytes per 1000 ticks, "
+	 << (BulkMessages * (double) size) / (elapsed * 1e6) 
+	 << " MB per host second\n";
+    delete [] data;
 
+    interrupt->Halt();
 }
 
-void Kernel::ExecAll()
-{
-	for (int i=1;i<=execfileNum;i++) {
-		int a = Exec(execfile[i]);
+//----------------------------------------------------------------------
+// Kernel::TransportBulkTest
+//      Like NetworkBulkTest, but over a reliable connection between
+//	mailbox #2 on machines #0 and #1, so that it works on a lossy 
+//	network (e.g., -n 0.9).  Machine #0 sends the messages as one
+//	stream and waits for all of it to be acknowledged; machine #1
+//	checks the stream as it arrives.  Machine #0 reports how busy 
+//	it kept the link -- the fraction of the time a packet was 
+//	being sent.
+//
+//	Machine #1 hangs around for TransportLinger ticks after it has
+//	everything, in case its last acknowledgement was lost and has
+//	to be sent again.
+//
+//	"size" -- bytes in each message
+//	"window" -- segments the connection can have outstanding
+//----------------------------------------------------------------------
+
+static const int TransportLinger = 1000000;
+
+void
+Kernel::TransportBulkTest(int size, int window) {
+    Transport *conn;
+    char *data = new char[size];
+    int sent = stats->numPacketsSent;
+    int startTicks = stats->totalTicks;
+    double start = HostTime();
+    double elapsed;
+    int ticks;
+
+    ASSERT(size > 0);
+    ASSERT(hostName == 0 || hostName == 1);
+
+    conn = new Transport(2, 1 - hostName, 2, window);
+    if (hostName == 0) {
+	for (int i = 0; i < size; i++) {
+	    data[i] = (char) i;
+	}
+	for (int i = 0; i < BulkMessages; i++) {
+	    conn->Send(data, size);
+	}
+	conn->Flush();
+    } else {
+	int pos = 0;
+
+	while (pos < BulkMessages * size) {
+	    int n = conn->Receive(data, size);
+
+	    for (int j = 0; j < n; j++, pos++) {
+		ASSERT(data[j] == (char) (pos % size));
+	    }
 	}
-	currentThread->Finish();
-    //Kernel::Exec();
+    }
+    elapsed = HostTime() - start;
+    ticks = stats->totalTicks - startTicks;
+    sent = stats->numPacketsSent - sent;
+
+    cout << "Transport bulk transfer: " << BulkMessages << " messages of " 
+	 << size << " bytes, window " << window << ", "
+	 << conn->NumSent() << " segments sent, " 
+	 << conn->NumRetransmitted() << " retransmitted, "
+	 << ticks << " ticks, "
+	 << (BulkMessages * (double) size * 1000) / ticks 
+	 << " bytes per 1000 ticks, link busy "
+	 << (sent * (double) NetworkTime * 100) / ticks << "%, "
+	 << (BulkMessages * (double) size) / (elapsed * 1e6) 
+	 << " MB per host second\n";
+    delete [] data;
+
+    if (hostName == 1) {
+	alarm->WaitUntil(TransportLinger);
+    }
+    interrupt->Halt();
 }
 
+//----------------------------------------------------------------------
+// Kernel::ClusterTest
+//      One machine's part in a test of "nodes" machines, numbered from
+//	0, all sending each other messages at once.  Each sends "count"
+//	messages to mailbox #3 of each of its targets, which depend on
+//	the traffic "pattern":
+//		"all" -- every other machine
+//		"ring" -- the next machine, wrapping around
+//		"fanin" -- machine #0 (which sends nothing)
+//
+//	First, the machines wait for each other to start (see
+//	ClusterSync), so that the timed part begins together and a
+//	machine started late isn't charged for the wait.  Packets sent
+//	and received for that don't count in the report.
+//
+//	Meanwhile a second thread takes in the messages sent to this 
+//	machine, and keeps a histogram of how long each took to arrive,
+//	in host microseconds (the machines are all on one host, so they
+//	share its clock).  It stops when everything has arrived, or when 
+//	nothing has for ClusterQuiet ticks.  Then the machine reports, 
+//	in a form network/cluster.cc can collect, and halts.
+//
+//	A machine that falls behind fills its socket, and packets sent
+//	to it are then dropped, and counted, rather than waited on (see
+//	SendToSocket): two machines flooding each other could otherwise
+//	deadlock.
+//
+//	"nodes" -- how many machines there are
+//	"pattern" -- who sends to whom
+//	"count" -- messages each machine sends to each of its targets
+//----------------------------------------------------------------------
+
+static const int ClusterBox = 3;
+static const int ClusterSyncBox = 4;	// for ClusterSync
+static const int ClusterSyncRetry = 100000; // ticks between asking again
+static const int ClusterQuiet = 5000000; // ticks to wait for stragglers
+static const int LatencyBuckets = 24;	// powers of two, up to 16 seconds
+
+class ClusterMessage {
+  public:
+    int from;			// sending machine
+    int seq;			// sequence number from that machine
+    double sentAt;		// host time it was sent
+};
 
-int Kernel::Exec(char* name)
+static int clusterExpected;		// messages that should arrive
+static int clusterReceived;		// messages that have
+static int clusterLatency[LatencyBuckets]; // how many took [2^i, 2^(i+1))
+					// microseconds
+static bool clusterDone;		// has the receiver finished?
+static bool clusterStarted;		// have we heard from the others?
+static bool *clusterHeard;		// which machines we know have started
+static int clusterSyncSent;		// packets ClusterSync has sent
+static int clusterSyncRecvd;		// and received
+
+//----------------------------------------------------------------------
+// ClusterSync
+//      Take in any messages to ClusterSyncBox, each asking whether
+//	this machine has started, or answering that question: either
+//	way, the machine that sent it has.  Answer the questions.
+//
+//	ClusterTest keeps calling this until the receiver is done, so
+//	that a machine which missed our answer (or our question, which
+//	it would have answered) can still ask.  The receiver itself 
+//	doesn't: waiting to send could leave it too far behind.
+//----------------------------------------------------------------------
+
+static void
+ClusterSyncSend(int to, int ask)
 {
-	t[threadNum] = new Thread(name, threadNum);
-	t[threadNum]->space = new AddrSpace();
-	t[threadNum]->Fork((VoidFunctionPtr) &ForkExecute, (void *)t[threadNum]);
-	threadNum++;
-
-	return threadNum-1;
-/*
-    cout << "Total threads number is " << execfileNum << endl;
-    for (int n=1;n<=execfileNum;n++) {
-		t[n] = new Thread(execfile[n]);
-		t[n]->space = new AddrSpace();
-		t[n]->Fork((VoidFunctionPtr) &ForkExecute, (void *)t[n]);
-		cout << "Thread " << execfile[n] << " is executing." << endl;
+    PacketHeader outPktHdr;
+    MailHeader outMailHdr;
+
+    outPktHdr.to = to;
+    outMailHdr.to = ClusterSyncBox;
+    outMailHdr.from = ClusterSyncBox;
+    outMailHdr.length = sizeof(ask);
+    kernel->postOfficeOut->Send(outPktHdr, outMailHdr, (char *) &ask);
+    clusterSyncSent++;
+}
+
+static void
+ClusterSync()
+{
+    Mail *mail;
+    int from, ask;
+
+    while ((mail = kernel->postOfficeIn->TryReceiveMail(ClusterSyncBox))
+								!= NULL) {
+	from = mail->pktHdr.from;
+	bcopy(mail->data, (char *) &ask, sizeof(ask));
+	mail->Release();
+	clusterSyncRecvd++;
+	clusterHeard[from] = TRUE;
+	if (ask) {
+	    ClusterSyncSend(from, FALSE);
+	}
+    }
+}
+
+static void
+ClusterReceiver(void *unused)
+{
+    Mail *mail;
+    ClusterMessage msg;
+    int lastArrival = kernel->stats->totalTicks;
+    int usec, bucket;
+
+    while (clusterReceived < clusterExpected &&
+	    kernel->stats->totalTicks - lastArrival < ClusterQuiet) {
+	mail = kernel->postOfficeIn->TryReceiveMail(ClusterBox);
+	if (mail == NULL) {
+	    if (!clusterStarted) {	// don't time out before we begin
+		lastArrival = kernel->stats->totalTicks;
+	    }
+	    kernel->alarm->WaitUntil(NetworkTime);
+	    continue;
+	}
+	bcopy(mail->data, (char *) &msg, sizeof(msg));
+	mail->Release();
+	usec = (int) ((HostTime() - msg.sentAt) * 1e6);
+	for (bucket = 0; bucket < LatencyBuckets - 1 && 
+					usec >= (2 << bucket); bucket++) {
+	}
+	clusterLatency[bucket]++;
+	clusterReceived++;
+	lastArrival = kernel->stats->totalTicks;
+    }
+    clusterDone = TRUE;
+}
+
+void
+Kernel::ClusterTest(int nodes, char *pattern, int count) {
+    PacketHeader outPktHdr;
+    MailHeader outMailHdr;
+    ClusterMessage msg;
+    int *targets = new int[nodes];
+    int numTargets = 0;
+    int heard, startTicks, lastAsk;
+    double start;
+    Thread *t;
+
+    ASSERT(nodes > 1 && 0 <= hostName && hostName < nodes && count > 0);
+
+    if (strcmp(pattern, "all") == 0) {
+	for (int i = 0; i < nodes; i++) {
+	    if (i != hostName) {
+		targets[numTargets++] = i;
+	    }
+	}
+	clusterExpected = count * (nodes - 1);
+    } else if (strcmp(pattern, "ring") == 0) {
+	targets[numTargets++] = (hostName + 1) % nodes;
+	clusterExpected = count;
+    } else if (strcmp(pattern, "fanin") == 0) {
+	if (hostName != 0) {
+	    targets[numTargets++] = 0;
+	}
+	clusterExpected = (hostName == 0) ? count * (nodes - 1) : 0;
+    } else {
+	cout << "Unknown traffic pattern " << pattern << "\n";
+	interrupt->Halt();
+    }
+    clusterReceived = 0;
+    for (int i = 0; i < LatencyBuckets; i++) {
+	clusterLatency[i] = 0;
+    }
+
+    clusterHeard = new bool[nodes];
+    for (int i = 0; i < nodes; i++) {
+	clusterHeard[i] = (i == hostName);
+    }
+    clusterSyncSent = clusterSyncRecvd = 0;
+    clusterStarted = FALSE;
+
+    // start taking in messages now, in case another machine starts
+    // sending before we've heard from everyone; left waiting, they 
+    // would use up the mail buffers
+    clusterDone = FALSE;
+    t = new Thread("cluster receiver", 1);
+    t->Fork(ClusterReceiver, NULL);
+
+    // wait for the others to start, asking again now and then, in
+    // case a question or answer was lost; give up on any that don't
+    // answer in ClusterQuiet ticks
+    startTicks = stats->totalTicks;
+    lastAsk = startTicks - ClusterSyncRetry;
+    for (;;) {
+	ClusterSync();
+	heard = 0;
+	for (int i = 0; i < nodes; i++) {
+	    heard += clusterHeard[i] ? 1 : 0;
+	}
+	if (heard == nodes || 
+		stats->totalTicks - startTicks >= ClusterQuiet) {
+	    break;
+	}
+	if (stats->totalTicks - lastAsk >= ClusterSyncRetry) {
+	    for (int i = 0; i < nodes; i++) {
+		if (!clusterHeard[i]) {
+		    ClusterSyncSend(i, TRUE);
+		}
+	    }
+	    lastAsk = stats->totalTicks;
+	}
+	alarm->WaitUntil(NetworkTime);
+    }
+    DEBUG(dbgNet, "Cluster node " << hostName << " heard from " << heard
+		<< " of " << nodes);
+
+    clusterStarted = TRUE;
+    DropWhenSocketFull(TRUE);
+    startTicks = stats->totalTicks;
+    start = HostTime();
+    // take turns among the targets, so they all get traffic at once
+    outMailHdr.to = ClusterBox;
+    outMailHdr.from = ClusterBox;
+    outMailHdr.length = sizeof(msg);
+    msg.from = hostName;
+    for (msg.seq = 0; msg.seq < count; msg.seq++) {
+	ClusterSync();
+	for (int i = 0; i < numTargets; i++) {
+	    outPktHdr.to = targets[i];
+	    msg.sentAt = HostTime();
+	    postOfficeOut->Send(outPktHdr, outMailHdr, (char *) &msg);
+	}
+    }
+    while (!clusterDone) {
+	ClusterSync();
+	alarm->WaitUntil(NetworkTime);
+    }
+    ClusterSync();
+
+    cout << "Cluster node " << hostName << ": messages sent " 
+	 << count * numTargets << ", received " << clusterReceived 
+	 << " of " << clusterExpected << ", packets sent "
+	 << stats->numPacketsSent - clusterSyncSent << ", received "
+	 << stats->numPacketsRecvd - clusterSyncRecvd << ", ticks "
+	 << stats->totalTicks - startTicks << ", host seconds "
+	 << HostTime() - start << ", dropped " << NumSocketDrops() << "\n";
+    for (int i = 0; i < LatencyBuckets; i++) {
+	if (clusterLatency[i] > 0) {
+	    cout << "Cluster latency " << (i == 0 ? 0 : 1 << i) << " " 
+		 << clusterLatency[i] << "\n";
 	}
-	cout << "debug Kernel::Run finished.\n";
-*/
-//  Thread *t1 = new Thread(execfile[1]);
-//  Thread *t1 = new Thread("../test/test1");
-//  Thread *t2 = new Thread("../test/test2");
-
-//    AddrSpace *halt = new AddrSpace();
-//  t1->space = new AddrSpace();
-//  t2->space = new AddrSpace();
-
-//    halt->Execute("../test/halt");
-//  t1->Fork((VoidFunctionPtr) &ForkExecute, (void *)t1);
-//  t2->Fork((VoidFunctionPtr) &ForkExecute, (void *)t2);
-
-//	currentThread->Finish();
-//    Kernel::Run();
-//  cout << "after ThreadedKernel:Run();" << endl;  // unreachable
+    }
+    delete [] clusterHeard;
+    delete [] targets;
+
+    interrupt->Halt();
+}
+
+#ifndef FILESYS_STUB
+//----------------------------------------------------------------------
+// Kernel::DiskBenchmark
+//      Measure how fast the file system can write a file, and read it
+//	back, DiskBenchChunk bytes at a time (each a single WriteAt or
+//	ReadAt, which the disk gets all at once).  Run it against a
+//	local disk, and against one on another machine (-rd), to see 
+//	what the network costs, and how much a bigger window helps.
+//	The file is checked, then removed, and Nachos halts.
+//
+//	"size" -- how many bytes to write and read
+//----------------------------------------------------------------------
+
+static const int DiskBenchChunk = 1024;
+
+void
+Kernel::DiskBenchmark(int size) {
+    char *name = "/DiskBench";
+    char *data = new char[size];
+    char *check = new char[size];
+    ::OpenFile *file;		// not Kernel::OpenFile
+    int start, writeTicks, readTicks;
+    double hostStart, writeSeconds, readSeconds;
+
+    ASSERT(size > 0);
+    for (int i = 0; i < size; i++) {
+	data[i] = 'a' + i % 26;
+    }
+    (void) fileSystem->Remove(name, FALSE);	// left from a killed run
+    if (!fileSystem->Create(name, size, FALSE)
+		|| (file = fileSystem->Open(name)) == NULL) {
+	cout << "Disk benchmark: can't create " << name << "\n";
+	interrupt->Halt();
+    }
+
+    start = stats->totalTicks;
+    hostStart = HostTime();
+    for (int done = 0; done < size; done += DiskBenchChunk) {
+	file->WriteAt(data + done, min(DiskBenchChunk, size - done), done);
+    }
+    writeTicks = stats->totalTicks - start;
+    writeSeconds = HostTime() - hostStart;
+
+    start = stats->totalTicks;
+    hostStart = HostTime();
+    for (int done = 0; done < size; done += DiskBenchChunk) {
+	file->ReadAt(check + done, min(DiskBenchChunk, size - done), done);
+    }
+    readTicks = stats->totalTicks - start;
+    readSeconds = HostTime() - hostStart;
+
+    for (int i = 0; i < size; i++) {
+	if (check[i] != data[i]) {
+	    cout << "Disk benchmark: read back wrong data at " << i << "\n";
+	    break;
+	}
+    }
+    delete file;
+    fileSystem->Remove(name, FALSE);
+    delete [] data;
+    delete [] check;
+
+    cout << "Disk benchmark: " << size << " bytes, write " << writeTicks
+	 << " ticks (" << size * 1000.0 / writeTicks << " bytes per 1000 "
+	 << "ticks, " << size / writeSeconds / 1e6 << " MB per host "
+	 << "second), read " << readTicks << " ticks (" 
+	 << size * 1000.0 / readTicks << " bytes per 1000 ticks, " 
+	 << size / readSeconds / 1e6 << " MB per host second)\n";
+    synchDisk->PrintStats();
+
+    interrupt->Halt();
+}
+#endif // FILESYS_STUB
+
+//----------------------------------------------------------------------
+// ForkExecute
+// 	Run the user program that Kernel::Exec loaded for thread "t".
+//----------------------------------------------------------------------
+
+static void
+ForkExecute(Thread *t)
+{
+    t->space->Execute(t->getName());
+}
+
+//----------------------------------------------------------------------
+// Kernel::ExecAll
+// 	Start each of the user programs given on the command line with
+//	"-e", then let them run.  Nachos halts when the last one exits,
+//	or right away if there are none and our disk is on another 
+//	machine.
+//----------------------------------------------------------------------
+
+void
+Kernel::ExecAll()
+{
+    if (execfileNum == 0 && diskHost >= 0) {
+	// nothing to run, and waiting on the network for the disk 
+	// server would keep us from ever halting
+	interrupt->Halt();
+    }
+    for (int i = 0; i < execfileNum; i++) {
+	(void) Exec(execfile[i]);
+    }
+    currentThread->Finish();
+}
+
+//----------------------------------------------------------------------
+// Kernel::Exec
+// 	Load a user program into memory, and start a thread running it,
+//	as a new process.  The process is a child of the process that
+//	the current thread belongs to, if any.  Returns the PID of the
+//	new process, or -1 if the program couldn't be loaded.
+//
+//	"name" is the file containing the program.
+//----------------------------------------------------------------------
+
+int
+Kernel::Exec(char* name)
+{
+    AddrSpace *space = new AddrSpace();
+    Process *process;
+    Thread *thread;
+
+    if (!space->Load(name)) {
+	delete space;
+	return -1;
+    }
+    process = processTable->Create(name, space, currentThread->getProcess());
+    thread = new Thread(process->getName(), process->getPid());
+    thread->space = space;
+    thread->setProcess(process);
+    (void) processTable->AddThread(process, thread, 0);
+    thread->Fork((VoidFunctionPtr) &ForkExecute, (void *) thread);
+    return process->getPid();
 }
 
 #ifdef FILESYS_STUB
@@ -24,6 +24,7 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class ProcessTable;
 
 
 
@@ -40,13 +41,24 @@ class Kernel {
 	// 2015.11.25 added
 	void PrepareToEnd(); // called before all running programs end
 	
-	void ExecAll();
-	int Exec(char* name);
+	void ExecAll();		// run the programs given with -e
+	int Exec(char* name);	// start a user program in a new
+				// process, returning its PID
     void ThreadSelfTest();	// self test of threads and synchronization
+    void ThreadBenchmark();	// measure the cost of thread operations
 	
     void ConsoleTest();         // interactive console self test
     void NetworkTest();         // interactive 2-machine network test
-	Thread* getThread(int threadID){return t[threadID];}    
+    void NetworkBulkTest(int size);
+				// 2-machine post office throughput test
+    void TransportBulkTest(int size, int window);
+				// same, over a reliable connection
+    void ClusterTest(int nodes, char *pattern, int count);
+				// many machines sending to each other
+#ifndef FILESYS_STUB
+    void DiskBenchmark(int size);
+				// measure file system throughput
+#endif
 
 	#ifdef FILESYS_STUB	
 	int CreateFile(char* filename); // fileSystem call
@@ -71,18 +83,30 @@ class Kernel {
     FileSystem *fileSystem;     
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
+    ProcessTable *processTable;	// the user programs that are running
 
     int hostName;               // machine identifier
 
   private:
 
-	Thread* t[10];
-	char*   execfile[10];
+	char**  execfile;	// programs to run, from the command line
 	int execfileNum;
-	int threadNum;
     bool randomSlice;		// enable pseudo-random time slicing
+    bool tickless;		// only interrupt the CPU when needed
+    SchedulerType schedulerType;	// scheduling policy
+    bool schedReport;		// print scheduling statistics at halt
+    int minQuantum, maxQuantum;	// bounds on adaptive time slices,
+				// 0 if time slices are fixed
     bool debugUserProg;         // single step user program
     double reliability;         // likelihood messages are dropped
+    bool networkFlag;		// start up the post office
+    bool diskServerFlag;	// serve our disk to other machines
+    int diskHost;		// machine whose disk to use, or -1 for
+				// our own
+    int diskWindow;		// most requests to it at once
+    int stripeDisks;		// disks to stripe across, or 0 for the
+				// usual one
+    bool mirrorDisks;		// give each a mirror?
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
 #ifndef FILESYS_STUB
@@ -4,23 +4,41 @@
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -sched <fifo|mlfq|prio|stride> -quantum <min> <max>
+//              -tickless -B
 //              -f -cp <unix file> <nachos file>
-//              -p <nachos file> -r <nachos file> -l -D
+//              -p <nachos file> -r <nachos file> -l -D -DB <size>
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -NB <message size>
+//              -NR <message size> <window>
+//              -raid <disks> -mirror -ds -rd <machine id> <window>
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -sched selects the scheduling policy, and prints per-thread
+//		turnaround and response times when Nachos halts
+//    -quantum adapts each thread's time slice to its behavior, between
+//		min and max ticks, and prints scheduling statistics
+//    -tickless only has the timer interrupt when some thread is waiting
+//		for the CPU, or sleeping in Alarm::WaitUntil
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
 //    -K run a simple self test of kernel threads and synchronization
+//    -B run a benchmark of the thread system
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -NB run a two-machine bulk transfer of messages of the given size
+//	(see Kernel::NetworkBulkTest)
+//    -NR run the same bulk transfer over a reliable connection with
+//	the given window (see Kernel::TransportBulkTest)
+//    -NC take part in a test of many machines sending each other
+//	messages (see Kernel::ClusterTest, and network/cluster.cc, 
+//	which starts the machines)
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
@@ -29,6 +47,17 @@
 //    -r removes a Nachos file from the file system
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system
+//    -DB writes and reads back a file of the given size, and reports
+//	how fast (see Kernel::DiskBenchmark)
+//
+//    Disk flags:
+//    -raid stripes the file system across the given number of disks,
+//	DISK_<machine id>_0, _1, ... (see filesys/diskarray.h)
+//    -mirror gives each disk a mirror (with -raid, or on its own for
+//	a mirrored pair)
+//    -ds serves this machine's disk to other machines
+//    -rd uses the disk of the given machine instead of our own, with
+//	up to the given number of requests to it at once
 //
 //  Note: the file system flags are not used if the stub filesystem
 //        is being used
@@ -180,8 +209,15 @@ main(int argc, char **argv)
     char *debugArg = "";
     char *userProgName = NULL;        // default is not to execute a user prog
     bool threadTestFlag = false;
+    bool threadBenchFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
+    int networkBulkSize = 0;	// message size for the bulk network test
+    int transportBulkSize = 0;	// same, over a reliable connection
+    int transportWindow = 0;
+    int clusterNodes = 0;	// machines in the cluster test
+    char *clusterPattern = NULL;
+    int clusterCount = 0;
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
@@ -189,6 +225,7 @@ main(int argc, char **argv)
     char *removeFileName = NULL;
     bool dirListFlag = false;
     bool dumpFlag = false;
+    int diskBenchSize = 0;	// file size for the disk benchmark
 	// MP4 mod tag
 	char *createDirectoryName = NULL;
 	char *listDirectoryName = NULL;
@@ -218,12 +255,33 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-K") == 0) {
 	    threadTestFlag = TRUE;
 	}
+	else if (strcmp(argv[i], "-B") == 0) {
+	    threadBenchFlag = TRUE;
+	}
 	else if (strcmp(argv[i], "-C") == 0) {
 	    consoleTestFlag = TRUE;
 	}
 	else if (strcmp(argv[i], "-N") == 0) {
 	    networkTestFlag = TRUE;
 	}
+	else if (strcmp(argv[i], "-NB") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is message size
+	    networkBulkSize = atoi(argv[i + 1]);
+	    i++;
+	}
+	else if (strcmp(argv[i], "-NR") == 0) {
+	    ASSERT(i + 2 < argc);   // message size, then window size
+	    transportBulkSize = atoi(argv[i + 1]);
+	    transportWindow = atoi(argv[i + 2]);
+	    i += 2;
+	}
+	else if (strcmp(argv[i], "-NC") == 0) {
+	    ASSERT(i + 3 < argc);   // machines, pattern, message count
+	    clusterNodes = atoi(argv[i + 1]);
+	    clusterPattern = argv[i + 2];
+	    clusterCount = atoi(argv[i + 3]);
+	    i += 3;
+	}
 #ifndef FILESYS_STUB
 	else if (strcmp(argv[i], "-cp") == 0) {
 	    ASSERT(i + 2 < argc);
@@ -275,15 +333,22 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-D") == 0) {
 	    dumpFlag = true;
 	}
+	else if (strcmp(argv[i], "-DB") == 0) {
+	    ASSERT(i + 1 < argc);
+	    diskBenchSize = atoi(argv[i + 1]);
+	    i++;
+	}
 #endif //FILESYS_STUB
 	else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-	    cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+	    cout << "Partial usage: nachos [-K] [-B] [-C] [-N] [-NB size]\n";
+	    cout << "Partial usage: nachos [-NR size window]\n";
+	    cout << "Partial usage: nachos [-NC nodes all|ring|fanin count]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
-            cout << "Partial usage: nachos [-l] [-D]\n";
+            cout << "Partial usage: nachos [-l] [-D] [-DB size]\n";
 #endif //FILESYS_STUB
 	}
 
@@ -303,12 +368,24 @@ main(int argc, char **argv)
     if (threadTestFlag) {
       kernel->ThreadSelfTest();  // test threads and synchronization
     }
+    if (threadBenchFlag) {
+      kernel->ThreadBenchmark();  // measure the thread system
+    }
     if (consoleTestFlag) {
       kernel->ConsoleTest();   // interactive test of the synchronized console
     }
     if (networkTestFlag) {
       kernel->NetworkTest();   // two-machine test of the network
     }
+    if (networkBulkSize > 0) {
+      kernel->NetworkBulkTest(networkBulkSize);  // measure the post office
+    }
+    if (transportBulkSize > 0) {
+      kernel->TransportBulkTest(transportBulkSize, transportWindow);
+    }
+    if (clusterNodes > 0) {
+      kernel->ClusterTest(clusterNodes, clusterPattern, clusterCount);
+    }
 
 #ifndef FILESYS_STUB
     if (RemoveFlag) {
@@ -336,6 +413,9 @@ main(int argc, char **argv)
     if (printFileName != NULL) {
       Print(printFileName);
     }
+    if (diskBenchSize > 0) {
+      kernel->DiskBenchmark(diskBenchSize);
+    }
 #endif // FILESYS_STUB
 
     // finally, run an initial user program if requested to do so
@@ -11,8 +11,16 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Four policies are implemented, selected when Nachos starts up:
+//	straight FIFO (the default), a multi-level feedback queue
+//	that favors threads that block often (interactive or I/O-bound
+//	programs) over threads that use up their whole time slice,
+//	strict priority scheduling, and stride scheduling, which 
+//	divides the CPU in proportion to each thread's tickets.
+//
+//	All four keep ready threads on the same array of run queues;
+//	they differ only in which queue a thread is put on, and (for
+//	stride scheduling) where in the queue.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -23,16 +31,100 @@
 #include "scheduler.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// LowestBit
+// 	Return the index of the lowest bit set in "mask", which must
+//	not be zero.
+//----------------------------------------------------------------------
+
+static int
+LowestBit(unsigned int mask)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(mask);
+#else
+    int i;
+
+    for (i = 0; (mask & 1) == 0; i++) {
+	mask >>= 1;
+    }
+    return i;
+#endif
+}
+
+//----------------------------------------------------------------------
+// ComparePass
+// 	Compare the pass of two threads, for stride scheduling.  The
+//	difference may not fit in an int, so don't return it.
+//----------------------------------------------------------------------
+
+static int
+ComparePass(Thread *x, Thread *y)
+{
+    if (x->getPass() < y->getPass()) {
+	return -1;
+    } else if (x->getPass() > y->getPass()) {
+	return 1;
+    }
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ThreadStat::ThreadStat
+// 	Record the timing of a thread that is about to finish.
+//
+//	"thread" is the finishing thread.
+//	"when" is the time at which it finished.
+//----------------------------------------------------------------------
+
+ThreadStat::ThreadStat(Thread *thread, int when)
+{
+    name = new char[strlen(thread->getName()) + 1];	// the thread's name
+    strcpy(name, thread->getName());	// may be freed along with it
+
+    id = thread->getID();
+    arrival = thread->getArrivalTime();
+    firstRun = thread->getFirstRunTime();
+    finish = when;
+    quantum = thread->getQuantum();
+    tickets = thread->getTickets();
+    userTicks = thread->getUserTicks();
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// ThreadStat::~ThreadStat
+// 	Deallocate the record of a finished thread.
+//----------------------------------------------------------------------
+
+ThreadStat::~ThreadStat()
+{
+    delete [] name;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
 //	Initially, no ready threads.
+//
+//	"schedType" is the scheduling policy to use.
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulerType schedType)
 { 
-    readyList = new List<Thread *>; 
+    ASSERT(NumMLFQLevels <= NumRunQueues);
+    ASSERT(NumRunQueues <= (int) (sizeof(readyMask) * 8));
+    type = schedType;
+    readyMask = 0;
+    numReady = 0;
+    numSwitches = 0;
+    lastAging = 0;
+    globalPass = 0;
+    adaptive = FALSE;
+    minQuantum = maxQuantum = TimerTicks;
     toBeDestroyed = NULL;
+    firstFinished = lastFinished = NULL;
+    report = FALSE;
 } 
 
 //----------------------------------------------------------------------
@@ -42,9 +134,91 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    while (firstFinished != NULL) {
+	ThreadStat *stat = firstFinished;
+
+	firstFinished = stat->next;
+	delete stat;
+    }
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::SetQuantumBounds
+// 	Give each thread its own time slice, adapted to how it behaves,
+//	instead of preempting on every timer interrupt.  Only applies
+//	to SchedFIFO and SchedPriority; SchedMLFQ has its own quanta.
+//
+//	A thread's quantum is doubled every time it uses all of it, and
+//	halved every time it blocks, within these bounds.  CPU-bound
+//	threads thus end up with long time slices and few context
+//	switches, and interactive threads with short ones.
+//
+//	Since preemption happens on timer interrupts, time slices are 
+//	in effect rounded up to a multiple of TimerTicks.
+//
+//	"min", "max" are the bounds on a time slice, in ticks.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetQuantumBounds(int min, int max)
+{
+    ASSERT(0 < min && min <= max);
+    adaptive = TRUE;
+    minQuantum = min;
+    maxQuantum = max;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QueueOf
+// 	Return the run queue a ready thread belongs on.
+//----------------------------------------------------------------------
+
+int
+Scheduler::QueueOf(Thread *thread)
+{
+    switch (type) {
+      case SchedMLFQ:
+	return thread->getLevel();
+      case SchedPriority:
+	return MaxPriority - thread->getPriority();
+      default:
+	return 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Enqueue, Scheduler::Dequeue
+// 	Put a thread on the end of its run queue (or for stride 
+//	scheduling, in its place), or take it off, keeping readyMask 
+//	up to date.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Enqueue(Thread *thread)
+{
+    int which = QueueOf(thread);
+
+    if (type == SchedStride) {		// kept in order of pass
+	runQueue[which].SortedInsert(thread, ComparePass);
+    } else {
+	runQueue[which].Append(thread);
+    }
+    readyMask |= (1U << which);
+    numReady++;
+}
+
+void
+Scheduler::Dequeue(Thread *thread)
+{
+    int which = QueueOf(thread);
+
+    runQueue[which].Remove(thread);
+    if (runQueue[which].IsEmpty()) {
+	readyMask &= ~(1U << which);
+    }
+    numReady--;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
@@ -59,8 +233,33 @@ Scheduler::ReadyToRun (Thread *thread)
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 	//cout << "Putting thread on ready list: " << thread->getName() << endl ;
+    if (thread->getArrivalTime() < 0) {	// first time on the ready list
+	thread->setArrivalTime(kernel->stats->totalTicks);
+	thread->setQuantum(minQuantum);	// short, until we know better
+    }
+    if (type == SchedMLFQ) {
+	// a thread that gave up the CPU to wait (for I/O, say) 
+	// before its time slice ran out moves up one level
+	if (thread->getStatus() == BLOCKED && thread->getLevel() > 0) {
+	    thread->setLevel(thread->getLevel() - 1);
+	    DEBUG(dbgThread, "Promoting thread: " << thread->getName() << " to level " << thread->getLevel());
+	}
+    }
+    if (type == SchedStride) {
+	if (thread == kernel->currentThread) {	// giving up the CPU
+	    Charge(thread);
+	} else {
+	    UpdateGlobalPass();
+	    if (thread->pass < globalPass) {
+		thread->pass = globalPass;	// new, or was blocked
+	    }
+	}
+    }
     thread->setStatus(READY);
-    readyList->Append(thread);
+    Enqueue(thread);
+    if (numReady == 1) {	// someone to time slice with now
+	kernel->alarm->Update();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -76,18 +275,230 @@ Scheduler::FindNextToRun ()
 {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
+    if (readyMask == 0) {
 		return NULL;
     } else {
-    	return readyList->RemoveFront();
+	Thread *thread = runQueue[LowestBit(readyMask)].Front();
+
+	Dequeue(thread);
+	if (type == SchedStride && thread->pass > globalPass) {
+	    globalPass = thread->pass;
+	}
+    	return thread;
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::ChangePriority
+// 	Change the priority of a thread on the ready list, moving it
+//	to the end of its new run queue.
+//
+//	"thread" is a ready thread.
+//	"newPriority" is its new priority.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ChangePriority(Thread *thread, int newPriority)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    ASSERT(thread->getStatus() == READY);
+
+    Dequeue(thread);
+    thread->priority = newPriority;
+    Enqueue(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ChangeTickets
+// 	Change the tickets of a thread on the ready list.  Its pass
+//	stays the same; only the stride it advances by from now on
+//	changes.  Dequeue and Enqueue are used so that the queue
+//	bookkeeping is the same as for any other change.
+//
+//	"thread" is a ready thread.
+//	"newTickets" is its new number of tickets.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ChangeTickets(Thread *thread, int newTickets)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    ASSERT(thread->getStatus() == READY);
+
+    Dequeue(thread);
+    thread->tickets = newTickets;
+    Enqueue(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Account for the CPU time used by a thread since it was last 
+//	dispatched (or charged): add it to the thread's user time, and
+//	for stride scheduling, advance its pass.  Idle time is not
+//	charged to anyone.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    Statistics *stats = kernel->stats;
+    int busy = stats->totalTicks - stats->idleTicks;
+
+    thread->userTicks += stats->userTicks - thread->dispatchUser;
+    if (type == SchedStride) {
+	thread->pass += (long long) (busy - thread->dispatchBusy) * 
+					(StrideOne / thread->tickets);
+    }
+    thread->dispatchBusy = busy;
+    thread->dispatchUser = stats->userTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::UpdateGlobalPass
+// 	For stride scheduling, bring globalPass up to the present: the
+//	lowest pass of the running thread (charged for the time it has
+//	used so far) and the ready ones.  A thread that becomes ready
+//	starts from there, if it is behind.  globalPass never goes back.
+//----------------------------------------------------------------------
+
+void
+Scheduler::UpdateGlobalPass()
+{
+    Thread *running = kernel->currentThread;
+    long long pass = globalPass;
+    bool any = FALSE;
+
+    if (running->getStatus() == RUNNING) {
+	Charge(running);
+	pass = running->pass;
+	any = TRUE;
+    }
+    if (numReady > 0 && (!any || runQueue[0].Front()->pass < pass)) {
+	pass = runQueue[0].Front()->pass;
+    }
+    if (pass > globalPass) {
+	globalPass = pass;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ShouldPreempt
+// 	Called from the timer interrupt handler, to decide whether the
+//	running thread should be time-sliced.
+//
+//	With SchedFIFO, every timer interrupt ends the time slice.
+//	With SchedMLFQ, the running thread keeps the CPU until it has
+//	used up the quantum for its level (in which case it is demoted),
+//	or until a thread at a higher level becomes ready.  This is also
+//	where we periodically move every thread back to the top level.
+//	With SchedPriority, the running thread is time-sliced only if
+//	there is a ready thread of the same or a higher priority.
+//
+//	With SchedStride, the running thread is time-sliced if a ready
+//	thread's pass is no greater than its own, after charging it for
+//	the time it has used so far.
+//
+//	With adaptive time slices, SchedFIFO and SchedPriority also
+//	wait for the running thread to use up its quantum, before
+//	giving the CPU to another thread of the same priority.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::ShouldPreempt()
+{
+    Thread *thread = kernel->currentThread;
+    int now = kernel->stats->totalTicks;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (type == SchedStride) {
+	Charge(thread);
+	return numReady > 0 && thread->pass >= runQueue[0].Front()->pass;
+    }
+    if (type == SchedPriority) {
+	unsigned int mine = 1U << QueueOf(thread);
+
+	if ((readyMask & (mine - 1)) != 0) {	// someone more important?
+	    return TRUE;
+	}
+	if ((readyMask & mine) == 0) {		// nobody to share with?
+	    return FALSE;
+	}
+    }
+    if (type != SchedMLFQ) {
+	return !adaptive || QuantumExpired(thread);
+    }
+
+    if (now - lastAging >= MLFQAgingTicks) {
+	Aging();
+    }
+
+    if (now - thread->getQuantumStart() >= MLFQQuantum[thread->getLevel()]) {
+	if (thread->getLevel() < NumMLFQLevels - 1) {
+	    thread->setLevel(thread->getLevel() + 1);
+	    DEBUG(dbgThread, "Demoting thread: " << thread->getName() << " to level " << thread->getLevel());
+	}
+	thread->setQuantumStart(now);	// in case nobody else is ready
+	return TRUE;
+    }
+
+    // is someone more important ready?
+    return (readyMask & ((1U << QueueOf(thread)) - 1)) != 0;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuantumExpired
+// 	Return TRUE if the running thread has used up its adaptive time
+//	slice.  If so, it looks CPU-bound, so give it a longer one next
+//	time.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::QuantumExpired(Thread *thread)
+{
+    int now = kernel->stats->totalTicks;
+    int quantum = thread->getQuantum();
+
+    if (now - thread->getQuantumStart() < quantum) {
+	return FALSE;
+    }
+    quantum = min(2 * quantum, maxQuantum);
+    thread->setQuantum(max(quantum, minQuantum));
+    thread->setQuantumStart(now);	// in case nobody else is ready
+    DEBUG(dbgThread, "Time slice of " << thread->getName() << " now " << thread->getQuantum());
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Aging
+// 	Move every thread, ready or running, back to the highest level,
+//	so that CPU-bound threads on the lower levels are not starved.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Aging()
+{
+    DEBUG(dbgThread, "Aging: moving all threads to level 0");
+
+    for (int i = 1; i < NumMLFQLevels; i++) {
+	while (!runQueue[i].IsEmpty()) {
+	    Thread *thread = runQueue[i].Front();
+
+	    Dequeue(thread);
+	    thread->setLevel(0);
+	    Enqueue(thread);
+	}
+    }
+    kernel->currentThread->setLevel(0);
+    lastAging = kernel->stats->totalTicks;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Run
 // 	Dispatch the CPU to nextThread.  Save the state of the old thread,
 //	and load the state of the new thread, by calling the machine
-//	dependent context switch routine, SWITCH.
+//	dependent context switch routine, SWITCH (or, with the ucontext
+//	backend, Thread::SwitchTo).
 //
 //      Note: we assume the state of the previously running thread has
 //	already been changed from running to blocked or ready (depending).
@@ -120,8 +531,24 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    if (adaptive && !finishing && oldThread->getStatus() == BLOCKED) {
+	// gave up the CPU to wait, so probably interactive
+	int quantum = max(oldThread->getQuantum() / 2, minQuantum);
+
+	oldThread->setQuantum(min(quantum, maxQuantum));
+    }
+
+    Charge(oldThread);			// for the CPU time it used
+    nextThread->dispatchBusy = kernel->stats->totalTicks - kernel->stats->idleTicks;
+    nextThread->dispatchUser = kernel->stats->userTicks;
+
+    numSwitches++;
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
+    nextThread->setQuantumStart(kernel->stats->totalTicks);
+    if (nextThread->getFirstRunTime() < 0) {
+	nextThread->setFirstRunTime(kernel->stats->totalTicks);
+    }
     
     DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
     
@@ -130,7 +557,11 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     // a bit to figure out what happens after this, both from the point
     // of view of the thread and from the perspective of the "outside world".
 
+#ifdef UCONTEXT
+    oldThread->SwitchTo(nextThread);
+#else
     SWITCH(oldThread, nextThread);
+#endif
 
     // we're back, running oldThread
       
@@ -175,5 +606,101 @@ void
 Scheduler::Print()
 {
     cout << "Ready list contents:\n";
-    readyList->Apply(ThreadPrint);
+    for (int i = 0; i < NumRunQueues; i++) {
+	if (!runQueue[i].IsEmpty()) {
+	    cout << "Queue " << i << ": ";
+	    runQueue[i].Apply(ThreadPrint);
+	    cout << "\n";
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ThreadFinished
+// 	Remember the timing of a thread that is finishing, so that
+//	we can report it when Nachos halts.
+//
+//	"thread" is the finishing thread.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ThreadFinished(Thread *thread)
+{
+    ThreadStat *stat;
+
+    if (!report || thread->getArrivalTime() < 0) {	// skip threads never started
+	return;
+    }
+    stat = new ThreadStat(thread, kernel->stats->totalTicks);
+    if (firstFinished == NULL) {
+	firstFinished = stat;
+    } else {
+	lastFinished->next = stat;
+    }
+    lastFinished = stat;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintStats
+// 	Print the turnaround time (finish - arrival) and the response
+//	time (first run - arrival) of every thread that has finished,
+//	plus the thread running when Nachos halts, followed by the
+//	number of context switches and how busy the CPU was.  Only done
+//	if statistics were asked for on the command line.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintStats()
+{
+    Statistics *stats = kernel->stats;
+    int count = 0, totalTurnaround = 0, totalResponse = 0;
+    int totalUser = 0;
+
+    if (!report) {
+	return;
+    }
+    if (kernel->currentThread->getStatus() == RUNNING) {
+	Charge(kernel->currentThread);
+	ThreadFinished(kernel->currentThread);	// e.g., a program calling Halt
+    }
+
+    ThreadStat *stat;
+
+    for (stat = firstFinished; stat != NULL; stat = stat->next) {
+	totalUser += stat->userTicks;
+    }
+    cout << "Thread statistics:\n";
+    for (stat = firstFinished; stat != NULL; stat = stat->next) {
+	int turnaround = stat->finish - stat->arrival;
+	int response = stat->firstRun - stat->arrival;
+
+	cout << "Thread " << stat->id << " (" << stat->name << "): arrival "
+	     << stat->arrival << ", turnaround " << turnaround
+	     << ", response " << response;
+	if (adaptive) {
+	    cout << ", quantum " << stat->quantum;
+	}
+	if (type == SchedStride) {
+	    cout << ", tickets " << stat->tickets << ", user ticks " 
+		 << stat->userTicks;
+	    if (totalUser > 0) {
+		cout << " (" << (100.0 * stat->userTicks) / totalUser << "%)";
+	    }
+	}
+	cout << "\n";
+	totalTurnaround += turnaround;
+	totalResponse += response;
+	count++;
+    }
+    if (count > 0) {
+	cout << "Average turnaround " << totalTurnaround / count
+	     << ", average response " << totalResponse / count << "\n";
+    }
+    cout << "Context switches " << numSwitches;
+    if (stats->totalTicks > 0) {
+	cout << ", CPU utilization " 
+	     << (100.0 * (stats->totalTicks - stats->idleTicks)) / stats->totalTicks
+	     << "%";
+    }
+    cout << "\n";
 }
@@ -12,6 +12,65 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "stats.h"
+
+// The scheduling policies we support, selected with "-sched" at startup.
+//	SchedFIFO -- straight round-robin, one time slice per timer interrupt
+//	SchedMLFQ -- multi-level feedback queue
+//	SchedPriority -- strict priority (see Thread::SetPriority), 
+//		round-robin among threads of the same priority
+//	SchedStride -- proportional share (see Thread::SetTickets)
+enum SchedulerType { SchedFIFO, SchedMLFQ, SchedPriority, SchedStride };
+
+// Ready threads are kept on an array of run queues, one per priority,
+// with a bitmap recording which of the queues are non-empty.  Lower
+// numbered queues are served first.  This way, both putting a thread 
+// on the ready list and finding the next thread to run take constant
+// time, no matter how many threads are ready.
+const int NumRunQueues = NumPriorities;
+
+// Parameters of the multi-level feedback queue.  Level 0 is the
+// highest priority.  A thread that uses up its whole quantum at a level
+// is demoted one level; a thread that blocks (e.g., waiting for I/O)
+// is promoted one level when it is woken up.  Every MLFQAgingTicks,
+// all threads are moved back to level 0, so that CPU-bound threads
+// at the bottom do not starve.
+
+const int NumMLFQLevels = 3;
+const int MLFQQuantum[NumMLFQLevels] =	// time slice at each level, in ticks
+			{ TimerTicks, 2 * TimerTicks, 4 * TimerTicks };
+const int MLFQAgingTicks = 50 * TimerTicks;
+
+// Stride scheduling.  Each thread has a "pass", which advances by its
+// "stride" -- StrideOne divided by its number of tickets -- for every
+// tick of CPU time it uses, user or system.  The ready thread with the
+// lowest pass runs next.  Over time, each thread gets CPU time in 
+// proportion to its tickets.  A thread that has been blocked starts 
+// again from the current pass, so it can't save up CPU time.
+// Passes are 64 bits, so that they never wrap around.
+// StrideOne is much larger than MaxTickets, so that rounding the
+// stride down changes the share of a thread with MaxTickets by
+// under 1%.
+const int StrideOne = (1 << 20);
+
+// The following class records the timing of a thread that has
+// finished, so that it can be reported when Nachos halts.
+
+class ThreadStat {
+  public:
+    ThreadStat(Thread *thread, int finish);
+    ~ThreadStat();
+    
+    char *name;			// name of the finished thread
+    int id;			// its thread ID
+    int arrival;		// when it was first put on the ready list
+    int firstRun;		// when it first got the CPU
+    int finish;			// when it finished
+    int quantum;		// its time slice at the end
+    int tickets;		// its tickets at the end
+    int userTicks;		// user instructions it executed
+    ThreadStat *next;		// the next thread to finish, NULL if none
+};
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -19,7 +78,7 @@
 
 class Scheduler {
   public:
-    Scheduler();		// Initialize list of ready threads 
+    Scheduler(SchedulerType type);	// Initialize list of ready threads 
     ~Scheduler();		// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	
@@ -30,15 +89,59 @@ class Scheduler {
     				// Cause nextThread to start running
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
+    bool ShouldPreempt();	// Called on each timer interrupt; 
+				// should the running thread give 
+				// up the CPU?
+    void ChangePriority(Thread *thread, int newPriority);
+    				// Move a ready thread to another queue
+    void ChangeTickets(Thread *thread, int newTickets);
+    				// Change the share of a ready thread
+    int NumReady() { return numReady; }	// how many threads are ready?
+    int NumSwitches() { return numSwitches; }
+    				// how many context switches so far?
+    void ThreadFinished(Thread *thread);
+    				// Record the timing of a finished thread
     void Print();		// Print contents of ready list
+    void PrintStats();		// Print per-thread turnaround and 
+				// response times
     
+    void EnableReport() { report = TRUE; }
+    				// Print statistics when Nachos halts
+    void SetQuantumBounds(int min, int max);
+    				// Adapt each thread's time slice,
+				// within these bounds
+
     // SelfTest for scheduler is implemented in class Thread
     
   private:
-    List<Thread *> *readyList;  // queue of threads that are ready to run,
+    SchedulerType type;		// which scheduling policy to use
+    ThreadQueue runQueue[NumRunQueues];
+    				// threads that are ready to run,
 				// but not running
+    unsigned int readyMask;	// bit i is set if runQueue[i] is non-empty
+    int numReady;		// number of threads on all the run queues
+    int numSwitches;		// number of context switches
+    int lastAging;		// when we last moved every thread to level 0
+    long long globalPass;	// lowest pass of the threads that want
+				// the CPU, when last brought up to date
+    bool adaptive;		// adapt the time slice of each thread?
+    int minQuantum, maxQuantum;	// bounds on adaptive time slices
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
+    ThreadStat *firstFinished;	// timing of threads that have finished,
+    ThreadStat *lastFinished;	// in the order they did; linked through
+    				// ThreadStat::next, so that recording
+				// one takes constant time
+    bool report;		// print statistics at halt?
+
+    int QueueOf(Thread *thread);// which run queue does thread go on?
+    void Enqueue(Thread *thread);// put thread on its run queue
+    void Dequeue(Thread *thread);// take thread off its run queue
+    void Aging();		// move every thread back to level 0
+    bool QuantumExpired(Thread *thread);
+    				// has thread used up its time slice?
+    void Charge(Thread *thread);// account for CPU time used by thread
+    void UpdateGlobalPass();	// bring globalPass up to the present
 };
 
 #endif // SCHEDULER_H
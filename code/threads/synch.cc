@@ -18,15 +18,17 @@
 //
 // Once we'e implemented one set of higher level atomic operations,
 // we can implement others using that implementation.  We illustrate
-// this by implementing locks and condition variables on top of 
-// semaphores, instead of directly enabling and disabling interrupts.
+// this by implementing locks on top of semaphores, instead of directly 
+// enabling and disabling interrupts.
 //
 // Locks are implemented using a semaphore to keep track of
 // whether the lock is held or not -- a semaphore value of 0 means
 // the lock is busy; a semaphore value of 1 means the lock is free.
 //
-// The implementation of condition variables using semaphores is
-// a bit trickier, as explained below under Condition::Wait.
+// Waiting threads are kept on ThreadQueues, linked through the
+// Thread objects themselves, so waiting and waking up never allocate
+// memory.  Condition variables put the waiting thread straight on
+// their queue, as explained below under Condition::Wait.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -48,7 +50,6 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
 }
 
 //----------------------------------------------------------------------
@@ -59,7 +60,6 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 
 Semaphore::~Semaphore()
 {
-    delete queue;
 }
 
 //----------------------------------------------------------------------
@@ -82,7 +82,7 @@ Semaphore::P()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
     
     while (value == 0) { 		// semaphore not available
-	queue->Append(currentThread);	// so go to sleep
+	queue.Append(currentThread);	// so go to sleep
 	currentThread->Sleep(FALSE);
     } 
     value--; 			// semaphore available, consume its value
@@ -107,8 +107,8 @@ Semaphore::V()
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
     
-    if (!queue->IsEmpty()) {  // make thread ready.
-	kernel->scheduler->ReadyToRun(queue->RemoveFront());
+    if (!queue.IsEmpty()) {  // make thread ready.
+	kernel->scheduler->ReadyToRun(queue.RemoveFront());
     }
     value++;
     
@@ -213,7 +213,6 @@ void Lock::Release()
 Condition::Condition(char* debugName)
 {
     name = debugName;
-    waitQueue = new List<Semaphore *>;
 }
 
 //----------------------------------------------------------------------
@@ -223,17 +222,16 @@ Condition::Condition(char* debugName)
 
 Condition::~Condition()
 {
-    delete waitQueue;
 }
 
 //----------------------------------------------------------------------
 // Condition::Wait
 // 	Atomically release monitor lock and go to sleep.
-//	Our implementation uses semaphores to implement this, by
-//	allocating a semaphore for each waiting thread.  The signaller
-//	will V() this semaphore, so there is no chance the waiter
-//	will miss the signal, even though the lock is released before
-//	calling P().
+//	We put the current thread on the wait queue and release the
+//	lock with interrupts disabled, so that no signaller can run
+//	until we are asleep; that way there is no chance the waiter
+//	will miss the signal.  Since the thread itself is the queue
+//	entry, nothing needs to be allocated.
 //
 //	Note: we assume Mesa-style semantics, which means that the
 //	waiter must re-acquire the monitor lock when waking up.
@@ -243,16 +241,18 @@ Condition::~Condition()
 
 void Condition::Wait(Lock* conditionLock) 
 {
-     Semaphore *waiter;
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel;
     
-     ASSERT(conditionLock->IsHeldByCurrentThread());
+    ASSERT(conditionLock->IsHeldByCurrentThread());
 
-     waiter = new Semaphore("condition", 0);
-     waitQueue->Append(waiter);
-     conditionLock->Release();
-     waiter->P();
-     conditionLock->Acquire();
-     delete waiter;
+    oldLevel = interrupt->SetLevel(IntOff);
+    waitQueue.Append(currentThread);
+    conditionLock->Release();		// leaves interrupts disabled
+    currentThread->Sleep(FALSE);
+    (void) interrupt->SetLevel(oldLevel);
+    conditionLock->Acquire();
 }
 
 //----------------------------------------------------------------------
@@ -264,22 +264,23 @@ void Condition::Wait(Lock* conditionLock)
 //	being woken up (unlike Hoare-style).
 //
 //	Also note: we assume the caller holds the monitor lock
-//	(unlike what is described in Birrell's paper).  This allows
-//	us to access waitQueue without disabling interrupts.
+//	(unlike what is described in Birrell's paper).  We still 
+//	have to disable interrupts to put the waiter on the ready list.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Signal(Lock* conditionLock)
 {
-    Semaphore *waiter;
+    IntStatus oldLevel;
     
     ASSERT(conditionLock->IsHeldByCurrentThread());
     
-    if (!waitQueue->IsEmpty()) {
-        waiter = waitQueue->RemoveFront();
-	waiter->V();
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    if (!waitQueue.IsEmpty()) {
+	kernel->scheduler->ReadyToRun(waitQueue.RemoveFront());
     }
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -291,7 +292,13 @@ void Condition::Signal(Lock* conditionLock)
 
 void Condition::Broadcast(Lock* conditionLock) 
 {
-    while (!waitQueue->IsEmpty()) {
-        Signal(conditionLock);
+    IntStatus oldLevel;
+    
+    ASSERT(conditionLock->IsHeldByCurrentThread());
+    
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    while (!waitQueue.IsEmpty()) {
+	kernel->scheduler->ReadyToRun(waitQueue.RemoveFront());
     }
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
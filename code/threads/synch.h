@@ -50,8 +50,7 @@ class Semaphore {
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List<Thread *> *queue;     
-		  	// threads waiting in P() for the value to be > 0
+    ThreadQueue queue;	// threads waiting in P() for the value to be > 0
    };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -139,6 +138,6 @@ class Condition {
 
   private:
     char* name;
-    List<Semaphore *> *waitQueue;	// list of waiting threads
+    ThreadQueue waitQueue;		// threads waiting in Wait()
 };
 #endif // SYNCH_H
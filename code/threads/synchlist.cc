@@ -80,6 +80,30 @@ SynchList<T>::RemoveFront()
     return item;
 }
 
+//----------------------------------------------------------------------
+// SynchList<T>::TryRemoveFront
+//      Remove an "item" from the beginning of the list, if there is 
+//	one.  Don't wait.
+// Returns:
+//	TRUE, and the removed item in "item", or FALSE if the list
+//	was empty.
+//----------------------------------------------------------------------
+
+template <class T>
+bool
+SynchList<T>::TryRemoveFront(T *item)
+{
+    bool found;
+
+    lock->Acquire();			// enforce mutual exclusion
+    found = !list->IsEmpty();
+    if (found) {
+	*item = list->RemoveFront();
+    }
+    lock->Release();
+    return found;
+}
+
 //----------------------------------------------------------------------
 // SynchList<T>::Apply
 //      Apply function to every item on a list.
@@ -31,6 +31,8 @@ class SynchList {
 
     T RemoveFront();		// remove the first item from the front of
 				// the list, waiting if the list is empty
+    bool TryRemoveFront(T *item); // same, but return FALSE instead of
+				// waiting
 
     void Apply(void (*f)(T)); // apply function to all elements in list
 
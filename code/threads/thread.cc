@@ -16,6 +16,12 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
+// With _FORTIFY_SOURCE, glibc checks that _longjmp only unwinds to a
+// frame further up the same stack, and aborts when Thread::SwitchTo
+// jumps to another thread's stack.  It has to be turned off before
+// any system header is included.
+#undef _FORTIFY_SOURCE
+
 #include "copyright.h"
 #include "thread.h"
 #include "switch.h"
@@ -25,27 +31,91 @@
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
 
+// Free lists of execution stacks and Thread objects, left over from
+// threads that have finished.  Forking a short-lived thread can then
+// reuse them instead of going to the host's memory allocator, and a
+// recycled stack keeps the guard pages that AllocBoundedArray set up
+// around it.  Both lists are linked through the first word of each
+// free block.
+static char *freeStacks = NULL;
+static int numFreeStacks = 0;
+static void *freeThreads = NULL;
+static int numFreeThreads = 0;
+
+//----------------------------------------------------------------------
+// Thread::operator new, Thread::operator delete
+// 	Allocate a Thread object, from the free list if possible;
+//	put it back on the free list when it is deleted, unless
+//	the free list is full.
+//----------------------------------------------------------------------
+
+void *
+Thread::operator new(size_t size)
+{
+    void *ptr;
+
+    ASSERT(size == sizeof(Thread));
+    if (freeThreads == NULL) {
+	return ::operator new(size);
+    }
+    ptr = freeThreads;
+    freeThreads = *(void **) ptr;
+    numFreeThreads--;
+    return ptr;
+}
+
+void
+Thread::operator delete(void *ptr)
+{
+    if (numFreeThreads >= MaxFreeThreads) {
+	::operator delete(ptr);
+	return;
+    }
+    *(void **) ptr = freeThreads;
+    freeThreads = ptr;
+    numFreeThreads++;
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	We keep a copy, since it may be freed before we are (e.g., it
+//	is the name of the process we are running).
 //----------------------------------------------------------------------
 
 Thread::Thread(char* threadName, int threadID)
 {
 	ID = threadID;
-    name = threadName;
+    name = new char[strlen(threadName) + 1];
+    strcpy(name, threadName);
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    level = 0;
+    quantumStart = 0;
+    quantum = TimerTicks;
+    arrivalTime = -1;
+    firstRunTime = -1;
+    priority = DefaultPriority;
+    tickets = DefaultTickets;
+    pass = 0;
+    userTicks = dispatchBusy = dispatchUser = 0;
+    wakeTime = 0;
+    queueNext = queuePrev = NULL;
+    queue = NULL;
     for (int i = 0; i < MachineStateSize; i++) {
 	machineState[i] = NULL;		// not strictly necessary, since
 					// new thread ignores contents 
 					// of machine registers
     }
     space = NULL;
+    process = NULL;
+#ifdef UCONTEXT
+    started = TRUE;			// until it has a stack to start on
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -64,8 +134,17 @@ Thread::~Thread()
 {
     DEBUG(dbgThread, "Deleting thread: " << name);
     ASSERT(this != kernel->currentThread);
-    if (stack != NULL)
+    delete [] name;
+    if (stack == NULL) {
+	return;
+    }
+    if (numFreeStacks < MaxFreeStacks) {	// keep it for the next thread
+	*(char **) stack = freeStacks;
+	freeStacks = (char *) stack;
+	numFreeStacks++;
+    } else {
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+    }
 }
 
 //----------------------------------------------------------------------
@@ -95,7 +174,7 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     Scheduler *scheduler = kernel->scheduler;
     IntStatus oldLevel;
     
-    DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (int) func << " " << arg);
+    DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (void *) func << " " << arg);
     StackAllocate(func, arg);
 
     oldLevel = interrupt->SetLevel(IntOff);
@@ -104,6 +183,55 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     (void) interrupt->SetLevel(oldLevel);
 }    
 
+//----------------------------------------------------------------------
+// Thread::SetPriority
+// 	Change the priority of a thread.  If the thread is waiting
+//	on the ready list, the scheduler moves it to the right queue.
+//
+//	"newPriority" is between MinPriority and MaxPriority.
+//----------------------------------------------------------------------
+
+void
+Thread::SetPriority(int newPriority)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(newPriority >= MinPriority && newPriority <= MaxPriority);
+    DEBUG(dbgThread, "Setting priority of thread: " << name << " to " << newPriority);
+    
+    if (status == READY) {
+	kernel->scheduler->ChangePriority(this, newPriority);
+    } else {
+	priority = newPriority;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Thread::SetTickets
+// 	Change the number of tickets a thread holds.  If the thread is
+//	waiting on the ready list, the scheduler moves it to the right
+//	place.
+//
+//	"newTickets" is between MinTickets and MaxTickets.
+//----------------------------------------------------------------------
+
+void
+Thread::SetTickets(int newTickets)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(newTickets >= MinTickets && newTickets <= MaxTickets);
+    DEBUG(dbgThread, "Setting tickets of thread: " << name << " to " << newTickets);
+    
+    if (status == READY) {
+	kernel->scheduler->ChangeTickets(this, newTickets);
+    } else {
+	tickets = newTickets;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 // 	Check a thread's stack to see if it has overrun the space
@@ -174,6 +302,7 @@ Thread::Finish ()
     ASSERT(this == kernel->currentThread);
     
     DEBUG(dbgThread, "Finishing thread: " << name);
+    kernel->scheduler->ThreadFinished(this);
     Sleep(TRUE);				// invokes SWITCH
     // not reached
 }
@@ -263,8 +392,10 @@ Thread::Sleep (bool finishing)
 //	member function.
 //----------------------------------------------------------------------
 
+#ifndef UCONTEXT			// Thread::Root calls these itself
 static void ThreadFinish()    { kernel->currentThread->Finish(); }
 static void ThreadBegin() { kernel->currentThread->Begin(); }
+#endif
 void ThreadPrint(Thread *t) { t->Print(); }
 
 #ifdef PARISC
@@ -293,7 +424,8 @@ PLabelToAddr(void *plabel)
 
 //----------------------------------------------------------------------
 // Thread::StackAllocate
-//	Allocate and initialize an execution stack.  The stack is
+//	Allocate and initialize an execution stack, reusing the stack
+//	of a finished thread if there is one.  The stack is
 //	initialized with an initial stack frame for ThreadRoot, which:
 //		enables interrupts
 //		calls (*func)(arg)
@@ -306,7 +438,31 @@ PLabelToAddr(void *plabel)
 void
 Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    if (freeStacks != NULL) {
+	stack = (int *) freeStacks;
+	freeStacks = *(char **) freeStacks;
+	numFreeStacks--;
+    } else {
+	stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    }
+
+#ifdef UCONTEXT
+    // The host library builds the initial frame: the new thread starts
+    // in Thread::Root the first time it is switched to.
+#ifdef HPUX
+    stack[StackSize - 1] = STACK_FENCEPOST;
+#else
+    *stack = STACK_FENCEPOST;
+#endif
+    startFunc = func;
+    startArg = arg;
+    started = FALSE;
+    getcontext(&startContext);
+    startContext.uc_stack.ss_sp = (char *) stack;
+    startContext.uc_stack.ss_size = StackSize * sizeof(int);
+    startContext.uc_link = NULL;
+    makecontext(&startContext, Thread::Root, 0);
+#else	// UCONTEXT
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
@@ -346,6 +502,16 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
     *(--stackTop) = (int) ThreadRoot;
     *stack = STACK_FENCEPOST;
 #endif
+
+#ifdef x86_64
+    // As on the x86, SWITCH() returns to ThreadRoot, but the stack
+    // must be 16-byte aligned before each call, so the return address
+    // goes on a 16-byte boundary: ThreadRoot then starts with the
+    // stack as though it had been called.
+    stackTop = (int *) ((unsigned long) (stack + StackSize - 4) & ~15UL);
+    *(void **) stackTop = (void *) ThreadRoot;
+    *stack = STACK_FENCEPOST;
+#endif
     
 #ifdef PARISC
     machineState[PCState] = PLabelToAddr(ThreadRoot);
@@ -360,10 +526,188 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
     machineState[InitialArgState] = (void*)arg;
     machineState[WhenDonePCState] = (void*)ThreadFinish;
 #endif
+#endif	// UCONTEXT
 }
 
+#ifdef UCONTEXT
+
+//----------------------------------------------------------------------
+// Thread::Root
+//	Where a thread starts running, with the ucontext backend: it
+//	does what ThreadRoot does with SWITCH.  It never returns.
+//----------------------------------------------------------------------
+
+void
+Thread::Root()
+{
+    Thread *thread = kernel->currentThread;
+
+    thread->Begin();
+    (*thread->startFunc)(thread->startArg);
+    thread->Finish();
+}
+
+//----------------------------------------------------------------------
+// Thread::SwitchTo
+//	Stop running this thread and start running nextThread: what
+//	SWITCH does, with the ucontext backend.  Returns when some
+//	other thread switches back to this one.
+//
+//	A thread that has run before is resumed with _longjmp, which
+//	(unlike swapcontext) does not save and restore the signal mask,
+//	and so doesn't need a system call.  Only a thread's first start
+//	goes through setcontext.
+//
+//	AddressSanitizer can't follow _longjmp from one stack to another,
+//	but it does know about swapcontext, so that is used instead when
+//	Nachos is built with -fsanitize=address.  A thread's startContext
+//	then holds where to resume it, once it has started.
+//
+//	"nextThread" is the thread to run.
+//----------------------------------------------------------------------
+
+void
+Thread::SwitchTo(Thread *nextThread)
+{
+#ifdef __SANITIZE_ADDRESS__
+    nextThread->started = TRUE;
+    swapcontext(&startContext, &nextThread->startContext);
+#else
+    if (_setjmp(context) != 0) {
+	return;				// switched back to
+    }
+    if (nextThread->started) {
+	_longjmp(nextThread->context, 1);
+    }
+    nextThread->started = TRUE;
+    setcontext(&nextThread->startContext);
+    ASSERTNOTREACHED();
+#endif
+}
+
+#endif	// UCONTEXT
+
 #include "machine.h"
 
+//----------------------------------------------------------------------
+// ThreadQueue::Append
+// 	Put a thread at the end of the queue.  The thread must not
+//	already be on a queue.
+//----------------------------------------------------------------------
+
+void
+ThreadQueue::Append(Thread *thread)
+{
+    ASSERT(thread->queue == NULL);
+
+    thread->queue = this;
+    thread->queueNext = NULL;
+    thread->queuePrev = last;
+    if (last == NULL) {		// queue is empty
+	first = thread;
+    } else {
+	last->queueNext = thread;
+    }
+    last = thread;
+    numInQueue++;
+}
+
+//----------------------------------------------------------------------
+// ThreadQueue::RemoveFront
+// 	Take the first thread off the queue.  The queue must not be empty.
+//
+// Returns:
+//	The removed thread.
+//----------------------------------------------------------------------
+
+Thread *
+ThreadQueue::RemoveFront()
+{
+    Thread *thread = first;
+
+    ASSERT(!IsEmpty());
+    Remove(thread);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// ThreadQueue::Remove
+// 	Take a specific thread off the queue.  Must be on this queue!
+//----------------------------------------------------------------------
+
+void
+ThreadQueue::Remove(Thread *thread)
+{
+    ASSERT(thread->queue == this);
+
+    if (thread->queuePrev == NULL) {
+	first = thread->queueNext;
+    } else {
+	thread->queuePrev->queueNext = thread->queueNext;
+    }
+    if (thread->queueNext == NULL) {
+	last = thread->queuePrev;
+    } else {
+	thread->queueNext->queuePrev = thread->queuePrev;
+    }
+    thread->queueNext = thread->queuePrev = NULL;
+    thread->queue = NULL;
+    numInQueue--;
+}
+
+//----------------------------------------------------------------------
+// ThreadQueue::SortedInsert
+// 	Put a thread on the queue, after every thread that is not 
+//	greater than it according to "compare", and before the rest.
+//	The search starts from the end of the queue, since a thread
+//	usually belongs at or near the end.
+//
+//	"compare" returns < 0 if its first argument goes first, 0 if it
+//	doesn't matter, and > 0 if its second argument goes first.
+//----------------------------------------------------------------------
+
+void
+ThreadQueue::SortedInsert(Thread *thread, int (*compare)(Thread *, Thread *))
+{
+    Thread *ptr;
+
+    ASSERT(thread->queue == NULL);
+
+    for (ptr = last; ptr != NULL; ptr = ptr->queuePrev) {
+	if ((*compare)(thread, ptr) >= 0) {
+	    break;
+	}
+    }
+    thread->queue = this;
+    thread->queuePrev = ptr;		// goes right after ptr
+    if (ptr == NULL) {
+	thread->queueNext = first;
+	first = thread;
+    } else {
+	thread->queueNext = ptr->queueNext;
+	ptr->queueNext = thread;
+    }
+    if (thread->queueNext == NULL) {
+	last = thread;
+    } else {
+	thread->queueNext->queuePrev = thread;
+    }
+    numInQueue++;
+}
+
+//----------------------------------------------------------------------
+// ThreadQueue::Apply
+// 	Apply a function to every thread on the queue, front to back.
+//----------------------------------------------------------------------
+
+void
+ThreadQueue::Apply(void (*func)(Thread *))
+{
+    for (Thread *ptr = first; ptr != NULL; ptr = ptr->queueNext) {
+	(*func)(ptr);
+    }
+}
+
 //----------------------------------------------------------------------
 // Thread::SaveUserState
 //	Save the CPU state of a user program on a context switch.
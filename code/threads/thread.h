@@ -43,8 +43,14 @@
 #include "machine.h"
 #include "addrspace.h"
 
+#ifdef UCONTEXT
+#include <ucontext.h>
+#include <setjmp.h>
+#endif
+
 // CPU register state to be saved on context switch.  
-// The x86 needs to save only a few registers, 
+// The x86 and x86-64 need to save only a few registers
+// (on the x86-64 each slot of machineState holds one 8-byte register),
 // SPARC and MIPS needs to save 10 registers, 
 // the Snake needs 18,
 // and the RS6000 needs to save 75 (!)
@@ -57,10 +63,31 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);	// in words
 
+// The stacks and Thread objects of finished threads are kept for
+// reuse by later threads, up to this many of each.
+const int MaxFreeStacks = 64;
+const int MaxFreeThreads = 64;
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED, ZOMBIE };
 
+// Thread priorities, used by the priority scheduler.  A larger number
+// means a more important thread.
+const int NumPriorities = 32;
+const int MinPriority = 0;
+const int MaxPriority = NumPriorities - 1;
+const int DefaultPriority = NumPriorities / 2;
+
+// Tickets, used by the stride scheduler.  A thread's share of the CPU
+// is proportional to the number of tickets it holds.
+const int MinTickets = 1;
+const int MaxTickets = 10000;
+const int DefaultTickets = 100;
+
+class ThreadQueue;
+class Process;
+
 
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
@@ -80,6 +107,19 @@ class Thread {
     int *stackTop;			 // the current stack pointer
     void *machineState[MachineStateSize];  // all registers except for stackTop
 
+#ifdef UCONTEXT
+    // With the ucontext backend (build with -DUCONTEXT), threads are
+    // switched by SwitchTo rather than by SWITCH, and the two members
+    // above are unused.
+    jmp_buf context;			// registers while not running
+    ucontext_t startContext;		// where to start, if not started
+    bool started;			// has it run yet?
+    VoidFunctionPtr startFunc;		// the forked procedure
+    void *startArg;			// and its argument
+
+    static void Root();			// Start running startFunc
+#endif
+
   public:
     Thread(char* debugName, int threadID);		// initialize a Thread 
     ~Thread(); 				// deallocate a Thread
@@ -87,6 +127,9 @@ class Thread {
 					// must not be running when delete 
 					// is called
 
+    void *operator new(size_t size);	// allocate and free Thread objects
+    void operator delete(void *ptr);	// from a free list
+
     // basic thread operations
 
     void Fork(VoidFunctionPtr func, void *arg); 
@@ -99,6 +142,11 @@ class Thread {
     void Finish();  		// The thread is done executing
     
     void CheckOverflow();   	// Check if thread stack has overflowed
+#ifdef UCONTEXT
+    void SwitchTo(Thread *nextThread);
+    				// Run nextThread instead; used in place
+				// of SWITCH
+#endif
     void setStatus(ThreadStatus st) { status = st; }
     ThreadStatus getStatus() { return (status); }
 	char* getName() { return (name); }
@@ -107,6 +155,30 @@ class Thread {
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
 
+    // scheduling state, maintained by the Scheduler
+
+    int getLevel() { return level; }
+    void setLevel(int lv) { level = lv; }
+    int getQuantumStart() { return quantumStart; }
+    void setQuantumStart(int when) { quantumStart = when; }
+    int getArrivalTime() { return arrivalTime; }
+    void setArrivalTime(int when) { arrivalTime = when; }
+    int getFirstRunTime() { return firstRunTime; }
+    void setFirstRunTime(int when) { firstRunTime = when; }
+    int getPriority() { return priority; }
+    void SetPriority(int newPriority);
+    				// Change priority, moving the thread
+				// to another ready queue if need be
+    int getQuantum() { return quantum; }
+    void setQuantum(int ticks) { quantum = ticks; }
+    int getTickets() { return tickets; }
+    void SetTickets(int newTickets);
+    				// Change our share of the CPU
+    long long getPass() { return pass; }
+    int getUserTicks() { return userTicks; }
+    int getWakeTime() { return wakeTime; }
+    void setWakeTime(int when) { wakeTime = when; }
+
   private:
     // some of the private data for this class is listed above
     
@@ -116,6 +188,25 @@ class Thread {
     ThreadStatus status;	// ready, running or blocked
     char* name;
 	int   ID;
+    int level;			// MLFQ priority level, 0 is the highest
+    int quantumStart;		// when the current time slice began
+    int quantum;		// length of our time slice, if adaptive
+    int arrivalTime;		// when first made ready to run, -1 if never
+    int firstRunTime;		// when first given the CPU, -1 if never
+    int priority;		// MinPriority .. MaxPriority
+    int tickets;		// MinTickets .. MaxTickets
+    long long pass;		// virtual time, for the stride scheduler
+    int userTicks;		// user instructions executed so far
+    int dispatchBusy;		// stats when last given the CPU, to 
+    int dispatchUser;		// charge for the time we've had it
+    friend class Scheduler;	// to change the priority of a ready thread
+    int wakeTime;		// when to wake up from Alarm::WaitUntil
+
+    Thread *queueNext;		// links for the ThreadQueue we are on
+    Thread *queuePrev;
+    ThreadQueue *queue;		// which one, NULL if none
+    friend class ThreadQueue;
+
     void StackAllocate(VoidFunctionPtr func, void *arg);
     				// Allocate a stack for thread.
 				// Used internally by Fork()
@@ -131,6 +222,44 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+
+    Process *getProcess() { return process; }
+    void setProcess(Process *p) { process = p; }
+
+  private:
+    Process *process;			// The process we belong to, NULL
+					// if we only run in the kernel
+};
+
+// The following class defines a queue of threads, linked through
+// the Thread objects themselves.  Unlike a List<Thread *>, putting a 
+// thread on a ThreadQueue or taking it off never allocates memory, and
+// all operations, including removing a thread from the middle of the
+// queue, take constant time.  A thread can be on at most one
+// ThreadQueue at a time.
+
+class ThreadQueue {
+  public:
+    ThreadQueue() { first = last = NULL; numInQueue = 0; }
+    
+    void Append(Thread *thread);	// Put thread at the end of the queue
+    Thread *RemoveFront();		// Take the first thread off the queue
+    void Remove(Thread *thread);	// Take a specific thread off the queue
+    
+    Thread *Front() { return first; }
+    bool IsEmpty() { return first == NULL; }
+    int NumInQueue() { return numInQueue; }
+    bool IsInQueue(Thread *thread) { return thread->queue == this; }
+    
+    void SortedInsert(Thread *thread, int (*compare)(Thread *, Thread *));
+    					// Put thread after every thread
+					// that doesn't compare greater
+    void Apply(void (*func)(Thread *));	// apply function to every thread
+
+  private:
+    Thread *first;			// Head of the queue, NULL if empty
+    Thread *last;			// Last thread on the queue
+    int numInQueue;			// number of threads on the queue
 };
 
 // external function, dummy routine whose sole job is to call Thread::Print
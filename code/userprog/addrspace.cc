@@ -57,47 +57,82 @@ SwapHeader (NoffHeader *noffH)
 #endif
 }
 
+//----------------------------------------------------------------------
+// AllocateFrames, FreeFrames
+// 	Keep track of which physical page frames are in use.  An address
+//	space gets a contiguous run of frames, so that a buffer passed
+//	to a system call is contiguous in physical memory too, and the
+//	kernel can use it in place.
+//----------------------------------------------------------------------
+
+static bool frameInUse[NumPhysPages];
+
+static int
+AllocateFrames(int count)
+{
+    int first, run = 0;
+
+    for (first = 0; first + count <= NumPhysPages; first++) {
+	for (run = 0; run < count && !frameInUse[first + run]; run++)
+	    ;
+	if (run == count) {
+	    for (int i = first; i < first + count; i++) {
+		frameInUse[i] = TRUE;
+	    }
+	    return first;
+	}
+	first += run;		// skip past the frame in use
+    }
+    return -1;
+}
+
+static void
+FreeFrames(int first, int count)
+{
+    for (int i = first; i < first + count; i++) {
+	ASSERT(frameInUse[i]);
+	frameInUse[i] = FALSE;
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
-// 	Create an address space to run a user program.
-//	Set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+// 	Create an address space to run a user program.  The memory
+//	for it is allocated when the program is loaded, since until
+//	then we don't know how much we need.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace()
 {
-    pageTable = new TranslationEntry[NumPhysPages];
-    for (int i = 0; i < NumPhysPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virt page # = phys page #
-	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  
-    }
-    
-    // zero out the entire address space
-    bzero(kernel->machine->mainMemory, MemorySize);
+    pageTable = NULL;
+    numPages = 0;
+    firstFrame = -1;
+    freeStacks = new List<int>;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, and the memory it was using,
+//	including the stacks of any threads forked in it.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+    for (unsigned int i = 0; i < numPages; i++) {
+	FreeFrames(pageTable[i].physicalPage, 1);
+    }
+    delete [] pageTable;
+    delete freeStacks;
 }
 
-
 //----------------------------------------------------------------------
 // AddrSpace::Load
-// 	Load a user program into memory from a file.
+// 	Load a user program into memory from a file, after allocating
+//	memory for it and setting up the page table.
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	Assumes that the object code file is in NOFF format.  Returns
+//	FALSE if the file can't be opened, or there isn't enough free
+//	memory for it.
 //
 //	"fileName" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
@@ -108,6 +143,7 @@ AddrSpace::Load(char *fileName)
     OpenFile *executable = kernel->fileSystem->Open(fileName);
     NoffHeader noffH;
     unsigned int size;
+    char *base;				// where virtual address 0 is
 
     if (executable == NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
@@ -135,27 +171,39 @@ AddrSpace::Load(char *fileName)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
+    ASSERT(firstFrame < 0);			// only load once
+    firstFrame = AllocateFrames(numPages);
+    if (firstFrame < 0) {			// no virtual memory, yet
+	cerr << "Not enough memory to run " << fileName << "\n";
+	numPages = 0;
+	delete executable;
+	return FALSE;
+    }
+    pageTable = new TranslationEntry[numPages];
+    for (unsigned int i = 0; i < numPages; i++) {
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = firstFrame + i;
+	pageTable[i].valid = TRUE;
+	pageTable[i].use = FALSE;
+	pageTable[i].dirty = FALSE;
+	pageTable[i].readOnly = FALSE;  
+    }
+    base = &(kernel->machine->mainMemory[firstFrame * PageSize]);
+    bzero(base, size);				// zero out the address space
 
-    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
+    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size << " at frame " << firstFrame);
 
 // then, copy in the code and data segments into memory
-// Note: this code assumes that virtual address = physical address
     if (noffH.code.size > 0) {
         DEBUG(dbgAddr, "Initializing code segment.");
 	DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.code.virtualAddr]), 
+        executable->ReadAt(&base[noffH.code.virtualAddr], 
 			noffH.code.size, noffH.code.inFileAddr);
     }
     if (noffH.initData.size > 0) {
         DEBUG(dbgAddr, "Initializing data segment.");
 	DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
+        executable->ReadAt(&base[noffH.initData.virtualAddr],
 			noffH.initData.size, noffH.initData.inFileAddr);
     }
 
@@ -163,8 +211,7 @@ AddrSpace::Load(char *fileName)
     if (noffH.readonlyData.size > 0) {
         DEBUG(dbgAddr, "Initializing read only data segment.");
 	DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
+        executable->ReadAt(&base[noffH.readonlyData.virtualAddr],
 			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
     }
 #endif
@@ -199,6 +246,99 @@ AddrSpace::Execute(char* fileName)
 }
 
 
+//----------------------------------------------------------------------
+// AddrSpace::ExecuteThread
+// 	Run another thread in a user program, using the current thread.
+//	The program is already running in the address space, and a
+//	stack has been allocated for the thread.
+//
+//	"func" is the procedure the thread starts running.
+//	"returnAddr" is where it goes if the procedure returns.
+//	"stackTop" is the top of its stack, from AllocateStack.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ExecuteThread(int func, int returnAddr, int stackTop)
+{
+    kernel->currentThread->space = this;
+
+    this->InitThreadRegisters(func, returnAddr, stackTop);
+    this->RestoreState();		// load page table register
+
+    kernel->machine->Run();		// jump to the user progam
+
+    ASSERTNOTREACHED();			// the thread exits with the
+					// syscall "ThreadExit" or "Exit"
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+// 	Find room for the user stack of a new thread, reusing the stack
+//	of a thread that has exited if we can.  Otherwise we allocate
+//	contiguous frames for it, and map them above the rest of the
+//	address space, so the page table grows.  Returns the virtual
+//	address of the top of the stack, or 0 if memory is full.
+//
+//	Called by a thread running in this address space, so we must 
+//	tell the machine about the new page table.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateStack()
+{
+    unsigned int stackPages = divRoundUp(UserStackSize, PageSize);
+    TranslationEntry *newTable;
+    int frame;
+
+    if (!freeStacks->IsEmpty()) {
+	return freeStacks->RemoveFront();
+    }
+    frame = AllocateFrames(stackPages);
+    if (frame < 0) {
+	return 0;
+    }
+    newTable = new TranslationEntry[numPages + stackPages];
+    for (unsigned int i = 0; i < numPages; i++) {
+	newTable[i] = pageTable[i];
+    }
+    for (unsigned int i = 0; i < stackPages; i++) {
+	TranslationEntry *entry = &newTable[numPages + i];
+
+	entry->virtualPage = numPages + i;
+	entry->physicalPage = frame + i;
+	entry->valid = TRUE;
+	entry->use = FALSE;
+	entry->dirty = FALSE;
+	entry->readOnly = FALSE;  
+    }
+    bzero(&(kernel->machine->mainMemory[frame * PageSize]), 
+						stackPages * PageSize);
+    delete [] pageTable;
+    pageTable = newTable;
+    numPages += stackPages;
+    DEBUG(dbgAddr, "New thread stack at frame " << frame << ", top " << numPages * PageSize);
+
+    if (kernel->currentThread->space == this) {
+	RestoreState();
+    }
+    return numPages * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeStack
+// 	The thread using a stack has exited; keep the stack for the next
+//	thread forked in this address space.  The memory is freed along
+//	with the address space.
+//
+//	"stackTop" is the top of the stack, from AllocateStack.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FreeStack(int stackTop)
+{
+    freeStacks->Append(stackTop);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::InitRegisters
 // 	Set the initial values for the user-level register set.
@@ -235,6 +375,28 @@ AddrSpace::InitRegisters()
     DEBUG(dbgAddr, "Initializing stack pointer: " << numPages * PageSize - 16);
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::InitThreadRegisters
+// 	Set the initial values for the user-level register set of a 
+//	thread forked in the program: it starts at "func", on its own 
+//	stack, and returns to "returnAddr" if "func" returns.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitThreadRegisters(int func, int returnAddr, int stackTop)
+{
+    Machine *machine = kernel->machine;
+
+    for (int i = 0; i < NumTotalRegs; i++)
+	machine->WriteRegister(i, 0);
+
+    machine->WriteRegister(PCReg, func);	
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(RetAddrReg, returnAddr);
+    machine->WriteRegister(StackReg, stackTop - 16);
+    DEBUG(dbgAddr, "Initializing thread at " << func << ", stack pointer: " << stackTop - 16);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::SaveState
 // 	On a context switch, save any machine state, specific
@@ -261,6 +423,56 @@ void AddrSpace::RestoreState()
 }
 
 
+//----------------------------------------------------------------------
+// AddrSpace::KernelAddr
+// 	Return a pointer the kernel can use to get at "size" bytes of
+//	this address space, starting at virtual address "vaddr", or 
+//	NULL if they don't all belong to the address space.  The program
+//	and each thread stack are contiguous in physical memory, but not
+//	with each other, so we also return NULL if the bytes straddle two
+//	of them.
+//----------------------------------------------------------------------
+
+char *
+AddrSpace::KernelAddr(unsigned int vaddr, unsigned int size)
+{
+    unsigned int page = vaddr / PageSize;
+
+    if (vaddr >= numPages * PageSize || size > numPages * PageSize - vaddr) {
+	return NULL;
+    }
+    for (unsigned int p = page + 1; size > 0 && p <= (vaddr + size - 1) / PageSize; p++) {
+	if (pageTable[p].physicalPage != pageTable[p - 1].physicalPage + 1) {
+	    return NULL;
+	}
+    }
+    return &(kernel->machine->mainMemory[pageTable[page].physicalPage * PageSize 
+						+ vaddr % PageSize]);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ContiguousSize
+// 	Return how many bytes, starting at virtual address "vaddr",
+//	KernelAddr can return in one piece: up to the end of the
+//	address space, or of the program or thread stack "vaddr" is in.
+//	0 if "vaddr" isn't in the address space.
+//----------------------------------------------------------------------
+
+unsigned int
+AddrSpace::ContiguousSize(unsigned int vaddr)
+{
+    unsigned int p = vaddr / PageSize + 1;
+
+    if (vaddr >= numPages * PageSize) {
+	return 0;
+    }
+    while (p < numPages && 
+		pageTable[p].physicalPage == pageTable[p - 1].physicalPage + 1) {
+	p++;
+    }
+    return p * PageSize - vaddr;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::Translate
 //  Translate the virtual address in _vaddr_ to a physical address
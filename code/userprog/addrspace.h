@@ -2,7 +2,11 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
+//	Each address space gets its own run of contiguous physical page
+//	frames, so that several programs can be in memory at once.  
+//	Each extra thread forked in the address space gets a user stack
+//	of its own, another run of contiguous frames mapped above the
+//	program.
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
@@ -15,6 +19,7 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "list.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
@@ -30,10 +35,26 @@ class AddrSpace {
     void Execute(char *fileName);             	// Run a program
 					// assumes the program has already
                                         // been loaded
+    void ExecuteThread(int func, int returnAddr, int stackTop);
+    					// Run another thread in the program,
+					// starting at "func"
+
+    int AllocateStack();		// Find room for another thread's
+					// user stack; returns its top,
+					// 0 if there is no memory left
+    void FreeStack(int stackTop);	// The thread using it is done
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    char *KernelAddr(unsigned int vaddr, unsigned int size);
+    					// Where the kernel can find "size"
+					// bytes at user address "vaddr";
+					// NULL if not all in the space
+    unsigned int ContiguousSize(unsigned int vaddr);
+    					// How many bytes from "vaddr" on
+					// KernelAddr can give at once
+
     // Translate virtual address _vaddr_
     // to physical address _paddr_. _mode_
     // is 0 for Read, 1 for Write.
@@ -44,9 +65,15 @@ class AddrSpace {
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    int firstFrame;			// physical page of virtual page 0,
+					// -1 if nothing loaded
+    List<int> *freeStacks;		// stacks of threads that have exited
 
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
+    void InitThreadRegisters(int func, int returnAddr, int stackTop);
+    					// Same, for a thread forked in
+					// the program
 
 };
 
@@ -25,6 +25,121 @@
 #include "main.h"
 #include "syscall.h"
 #include "ksyscall.h"
+
+//----------------------------------------------------------------------
+// UserBuffer, UserString
+// 	Find a buffer, or a null-terminated string, that a user program
+//	passed to a system call, in the memory of its address space.
+//	Return NULL if it isn't all inside the address space.
+//
+//	"vaddr" is the user virtual address of the buffer or string.
+//	"size" is the size of the buffer.
+//----------------------------------------------------------------------
+
+static char *
+UserBuffer(int vaddr, int size)
+{
+    if (size < 0) {
+	return NULL;
+    }
+    return kernel->currentThread->space->KernelAddr(vaddr, size);
+}
+
+static char *
+UserString(int vaddr)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    char *str = space->KernelAddr(vaddr, 1);
+
+    if (str == NULL || 
+		memchr(str, '\0', space->ContiguousSize(vaddr)) == NULL) {
+	return NULL;
+    }
+    return str;
+}
+
+//----------------------------------------------------------------------
+// UserSendBatch, UserReceiveBatch
+// 	Send, or receive into, each of the MailMessages in an array a 
+//	user program passed to SendBatch or ReceiveBatch.  Each is four 
+//	words in its memory -- host, box, data, size -- in the 
+//	simulated machine's byte order.  Return how many messages were 
+//	sent or received, or -1 if the array itself isn't valid.
+//
+//	"msgs" is the user virtual address of the array.
+//	"count" is the number of messages in it.
+//	"box" is the mailbox to receive from.
+//----------------------------------------------------------------------
+
+static int
+UserSendBatch(int msgs, int count)
+{
+    unsigned int *msg;
+    int i;
+
+    if (count < 0 || count > MemorySize / 16 || 
+	    (msg = (unsigned int *) UserBuffer(msgs, count * 16)) == NULL) {
+	return -1;
+    }
+    for (i = 0; i < count; i++, msg += 4) {
+	int size = WordToHost(msg[3]);
+	char *data = UserBuffer(WordToHost(msg[2]), size);
+
+	if (data == NULL || SysSend(WordToHost(msg[0]), WordToHost(msg[1]), 
+						data, size) < 0) {
+	    break;
+	}
+    }
+    return i;
+}
+
+static int
+UserReceiveBatch(int box, int msgs, int count)
+{
+    unsigned int *msg;
+    int i, size, fromHost;
+
+    if (count <= 0 || count > MemorySize / 16 || !SysValidBox(box) ||
+	    (msg = (unsigned int *) UserBuffer(msgs, count * 16)) == NULL) {
+	return -1;
+    }
+    for (i = 0; i < count; i++, msg += 4) {
+	char *data = UserBuffer(WordToHost(msg[2]), WordToHost(msg[3]));
+
+	if (data == NULL) {
+	    break;
+	}
+	size = SysReceive(box, data, WordToHost(msg[3]), &fromHost, i == 0);
+	if (size < 0) {			// nothing more waiting
+	    break;
+	}
+	msg[0] = WordToMachine(fromHost);
+	msg[1] = WordToMachine(box);
+	msg[3] = WordToMachine(size);
+    }
+    return i;
+}
+
+//----------------------------------------------------------------------
+// ReturnToUser
+// 	Called just before the machine goes back to running user code, 
+//	after a system call or exception, or after a context switch.
+//	If another thread has called Exit in the meantime, the process
+//	is exiting, and this thread must stop too.
+//----------------------------------------------------------------------
+
+void
+ReturnToUser()
+{
+    Process *process = kernel->currentThread->getProcess();
+
+    if (process != NULL && process->isExiting()) {
+	DEBUG(dbgSys, "Process " << process->getPid() << " is exiting, stopping thread\n");
+	SysThreadExit(process->getExitStatus());
+	ASSERTNOTREACHED();
+    }
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -70,8 +185,10 @@ ExceptionHandler(ExceptionType which)
 			DEBUG(dbgSys, "Message received.\n");
 			val = kernel->machine->ReadRegister(4);
 			{
-			char *msg = &(kernel->machine->mainMemory[val]);
-			cout << msg << endl;
+			char *msg = UserString(val);
+			if (msg != NULL) {
+			    cout << msg << endl;
+			}
 			}
 			SysHalt();
 			ASSERTNOTREACHED();
@@ -80,9 +197,9 @@ ExceptionHandler(ExceptionType which)
 		case SC_Create:
 			val = kernel->machine->ReadRegister(4);
 			{
-			char *filename = &(kernel->machine->mainMemory[val]);
+			char *filename = UserString(val);
 			//cout << filename << endl;
-			status = SysCreate(filename);
+			status = (filename == NULL) ? 0 : SysCreate(filename);
 			kernel->machine->WriteRegister(2, (int) status);
 			}
 			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -95,9 +212,10 @@ ExceptionHandler(ExceptionType which)
 		case SC_Create:
 			val = kernel->machine->ReadRegister(4);
 			{
-			filename = &(kernel->machine->mainMemory[val]);
+			filename = UserString(val);
 			//cout << filename << endl;
-			status = SysCreate(filename,kernel->machine->ReadRegister(5));
+			status = (filename == NULL) ? 0 :
+			    SysCreate(filename,kernel->machine->ReadRegister(5));
 			kernel->machine->WriteRegister(2, (int) status);
 			}
 			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -109,8 +227,8 @@ ExceptionHandler(ExceptionType which)
 		 case SC_Open:
             val = kernel->machine->ReadRegister(4);
             {
-            filename = &(kernel->machine->mainMemory[val]);
-            fileid = SysOpen(filename);
+            filename = UserString(val);
+            fileid = (filename == NULL) ? -1 : SysOpen(filename);
 			kernel->machine->WriteRegister(2,(int) fileid);
             }
 	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -122,8 +240,9 @@ ExceptionHandler(ExceptionType which)
          case SC_Read:
             val = kernel->machine->ReadRegister(4);
             {
-			buffer = &(kernel->machine->mainMemory[val]);
-            status = SysRead(buffer,kernel->machine->ReadRegister(5),kernel->machine->ReadRegister(6));
+			buffer = UserBuffer(val, kernel->machine->ReadRegister(5));
+            status = (buffer == NULL) ? -1 :
+                SysRead(buffer,kernel->machine->ReadRegister(5),kernel->machine->ReadRegister(6));
 			kernel->machine->WriteRegister(2, (int) status);
             }
 	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -135,8 +254,9 @@ ExceptionHandler(ExceptionType which)
          case SC_Write:
             val = kernel->machine->ReadRegister(4);
             {
-            buffer = &(kernel->machine->mainMemory[val]);
-            status = SysWrite(buffer,kernel->machine->ReadRegister(5),kernel->machine->ReadRegister(6));
+            buffer = UserBuffer(val, kernel->machine->ReadRegister(5));
+            status = (buffer == NULL) ? -1 :
+                SysWrite(buffer,kernel->machine->ReadRegister(5),kernel->machine->ReadRegister(6));
 			kernel->machine->WriteRegister(2, (int) status);
             }
 	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -156,6 +276,185 @@ ExceptionHandler(ExceptionType which)
 			return;
             ASSERTNOTREACHED();
 			break;
+         case SC_Sleep:
+			DEBUG(dbgSys, "Sleep " << kernel->machine->ReadRegister(4) << "\n");
+			SysSleep(kernel->machine->ReadRegister(4));
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_SetTickets:
+			DEBUG(dbgSys, "SetTickets " << kernel->machine->ReadRegister(4) << "\n");
+			status = SysSetTickets(kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int) status);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_PutString:
+            val = kernel->machine->ReadRegister(4);
+            {
+            buffer = UserString(val);
+            status = (buffer == NULL) ? -1 : SysPutString(buffer);
+			kernel->machine->WriteRegister(2, (int) status);
+            }
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_ReadLine:
+            val = kernel->machine->ReadRegister(4);
+            {
+            int size = kernel->machine->ReadRegister(5);
+
+            buffer = UserBuffer(val, size);
+            status = (buffer == NULL || size <= 0) ? -1 : SysReadLine(buffer, size);
+			kernel->machine->WriteRegister(2, (int) status);
+            }
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_HostId:
+			status = SysHostId();
+			kernel->machine->WriteRegister(2, (int) status);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_Send:
+            val = kernel->machine->ReadRegister(6);
+            {
+            int size = kernel->machine->ReadRegister(7);
+
+			DEBUG(dbgSys, "Send to " << kernel->machine->ReadRegister(4) << ", box " << kernel->machine->ReadRegister(5) << ", " << size << " bytes\n");
+            buffer = UserBuffer(val, size);
+            status = (buffer == NULL) ? -1 :
+                SysSend(kernel->machine->ReadRegister(4), kernel->machine->ReadRegister(5), buffer, size);
+			kernel->machine->WriteRegister(2, (int) status);
+            }
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_Receive:
+         case SC_TryReceive:
+            val = kernel->machine->ReadRegister(5);
+            {
+            int size = kernel->machine->ReadRegister(6);
+            int from = kernel->machine->ReadRegister(7);
+            int fromHost;
+            char *fromAddr = (from == 0) ? NULL : UserBuffer(from, sizeof(int));
+
+			DEBUG(dbgSys, "Receive from box " << kernel->machine->ReadRegister(4) << "\n");
+            buffer = UserBuffer(val, size);
+            status = (buffer == NULL || (from != 0 && fromAddr == NULL)) ? -1 :
+                SysReceive(kernel->machine->ReadRegister(4), buffer, size, &fromHost, type == SC_Receive);
+            if (status >= 0 && fromAddr != NULL) {
+                *(unsigned int *) fromAddr = WordToMachine(fromHost);
+            }
+			kernel->machine->WriteRegister(2, (int) status);
+            }
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_SendBatch:
+			DEBUG(dbgSys, "SendBatch " << kernel->machine->ReadRegister(5) << "\n");
+			status = UserSendBatch(kernel->machine->ReadRegister(4),
+					kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int) status);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_ReceiveBatch:
+			DEBUG(dbgSys, "ReceiveBatch " << kernel->machine->ReadRegister(6) << "\n");
+			status = UserReceiveBatch(kernel->machine->ReadRegister(4),
+					kernel->machine->ReadRegister(5),
+					kernel->machine->ReadRegister(6));
+			kernel->machine->WriteRegister(2, (int) status);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_Exec:
+            val = kernel->machine->ReadRegister(4);
+            {
+            filename = UserString(val);
+			DEBUG(dbgSys, "Exec " << (filename == NULL ? "(bad address)" : filename) << "\n");
+            programID = (filename == NULL) ? -1 : SysExec(filename);
+			kernel->machine->WriteRegister(2, (int) programID);
+            }
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_Join:
+			DEBUG(dbgSys, "Join " << kernel->machine->ReadRegister(4) << "\n");
+			status = SysJoin(kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int) status);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_ThreadFork:
+			DEBUG(dbgSys, "ThreadFork " << kernel->machine->ReadRegister(4) << "\n");
+			threadID = SysThreadFork(kernel->machine->ReadRegister(4),
+					kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int) threadID);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_ThreadYield:
+			DEBUG(dbgSys, "ThreadYield\n");
+			SysThreadYield();
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_ThreadJoin:
+			DEBUG(dbgSys, "ThreadJoin " << kernel->machine->ReadRegister(4) << "\n");
+			status = SysThreadJoin(kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int) status);
+	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+            ASSERTNOTREACHED();
+			break;
+         case SC_ThreadExit:
+			DEBUG(dbgSys, "ThreadExit " << kernel->machine->ReadRegister(4) << "\n");
+			SysThreadExit(kernel->machine->ReadRegister(4));
+			ASSERTNOTREACHED();
+			break;
       	case SC_Add:
 			DEBUG(dbgSys, "Add " << kernel->machine->ReadRegister(4) << " + " << kernel->machine->ReadRegister(5) << "\n");
 			/* Process SysAdd Systemcall*/
@@ -184,7 +483,8 @@ ExceptionHandler(ExceptionType which)
 			DEBUG(dbgAddr, "Program exit\n");
             val=kernel->machine->ReadRegister(4);
             cout << "return value:" << val << endl;
-			kernel->currentThread->Finish();
+			SysExit(val);
+			ASSERTNOTREACHED();
             break;
       	default:
 			cerr << "Unexpected system call " << type << "\n";
@@ -14,6 +14,8 @@
 #include "kernel.h"
 
 #include "synchconsole.h"
+#include "process.h"
+#include "post.h"
 
 
 void SysHalt()
@@ -51,6 +53,128 @@ int SysClose(int id)
 {
   return kernel->interrupt->CloseFile(id);
 }
+void SysSleep(int ticks)
+{
+  kernel->alarm->WaitUntil(ticks);
+}
+int SysSetTickets(int tickets)
+{
+  int old = kernel->currentThread->getTickets();
+
+  if (tickets < MinTickets || tickets > MaxTickets)
+    return -1;
+  kernel->currentThread->SetTickets(tickets);
+  return old;
+}
+int SysPutString(char *str)
+{
+  int size = strlen(str);
+
+  kernel->synchConsoleOut->PutString(str, size);
+  return size;
+}
+int SysReadLine(char *buffer, int size)
+{
+  return kernel->synchConsoleIn->ReadLine(buffer, size);
+}
+int SysHostId()
+{
+  return kernel->hostName;
+}
+bool SysValidBox(int box)
+{
+  return kernel->postOfficeIn != NULL && 
+		box >= 0 && box < kernel->postOfficeIn->NumBoxes();
+}
+int SysSend(int host, int box, char *data, int size)
+{
+  PacketHeader pktHdr;
+  MailHeader mailHdr;
+
+  if (!SysValidBox(box) || host < 0 || size < 0 || size > MaxMessageSize)
+    return -1;
+  pktHdr.to = host;
+  mailHdr.to = box;
+  mailHdr.from = box;		// replies come back to the same box
+  mailHdr.length = size;
+  kernel->postOfficeOut->Send(pktHdr, mailHdr, data);
+  return size;
+}
+int SysReceive(int box, char *buffer, int size, int *fromHost, bool wait)
+{
+  Mail *mail;
+
+  if (!SysValidBox(box) || size < 0)
+    return -1;
+  if (wait)
+    mail = kernel->postOfficeIn->ReceiveMail(box);
+  else if ((mail = kernel->postOfficeIn->TryReceiveMail(box)) == NULL)
+    return NoMessage;
+  size = min(size, (int)mail->mailHdr.length);
+  bcopy(mail->data, buffer, size);
+  *fromHost = mail->pktHdr.from;
+  mail->Release();
+  return size;
+}
+int SysExec(char *name)
+{
+  return kernel->Exec(name);
+}
+int SysJoin(int pid)
+{
+  return kernel->processTable->Join(kernel->currentThread->getProcess(), pid);
+}
+void SysThreadExit(int code)
+{
+  Thread *thread = kernel->currentThread;
+  Process *process = thread->getProcess();
+
+  // No other thread may run between ThreadExit and Finish: it could
+  // free the process, which Finish and the scheduler still use.
+  // ThreadExit leaves interrupts off for us.
+  (void) kernel->interrupt->SetLevel(IntOff);
+  thread->space = NULL;		// freed by the process table
+  kernel->processTable->ThreadExit(process, thread, code);
+  thread->Finish();
+}
+void SysExit(int status)
+{
+  kernel->processTable->Exit(kernel->currentThread->getProcess(), status);
+  SysThreadExit(status);
+}
+static void ForkUserThread(UserThread *userThread)
+{
+  ReturnToUser();		// in case the process exited already
+  kernel->currentThread->space->ExecuteThread(userThread->func,
+		userThread->returnAddr, userThread->stackTop);
+}
+int SysThreadFork(int func, int returnAddr)
+{
+  Thread *current = kernel->currentThread;
+  Process *process = current->getProcess();
+  int stackTop = current->space->AllocateStack();
+  UserThread *userThread;
+  Thread *thread;
+
+  if (stackTop == 0)
+    return -1;
+  thread = new Thread(process->getName(), process->getPid());
+  userThread = kernel->processTable->AddThread(process, thread, stackTop);
+  userThread->func = func;
+  userThread->returnAddr = returnAddr;
+  thread->space = current->space;
+  thread->setProcess(process);
+  thread->Fork((VoidFunctionPtr) ForkUserThread, (void *) userThread);
+  return userThread->tid;
+}
+void SysThreadYield()
+{
+  kernel->currentThread->Yield();
+}
+int SysThreadJoin(int tid)
+{
+  return kernel->processTable->ThreadJoin(kernel->currentThread->getProcess(), tid);
+}
 int SysCreate(char *filename,int size)
 {
 	// return value
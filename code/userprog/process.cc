@@ -0,0 +1,464 @@
+// process.cc
+//	Routines to keep track of user processes: create them, look them
+//	up by PID, record how they exit, and let a parent wait for a
+//	child to exit.
+//
+//	The process table is shared by every thread running in the
+//	kernel, so we disable interrupts while changing it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "process.h"
+#include "addrspace.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// ProcessKey, HashPid
+//	Retrieve the key (the PID) of a process, and hash it, for the
+//	process table.  PIDs are handed out in sequence, so they hash
+//	well just as they are.
+//----------------------------------------------------------------------
+
+static int
+ProcessKey(Process *process)
+{
+    return process->getPid();
+}
+
+static unsigned int
+HashPid(int pid)
+{
+    return (unsigned int) pid;
+}
+
+//----------------------------------------------------------------------
+// UserThread::UserThread
+// 	Initialize the record of a thread in a user process.
+//
+//	"id" is its thread ID.
+//	"t" is the kernel thread that runs it.
+//	"stack" is the top of its user stack, 0 if it is the first
+//		thread in the process, which runs on the program's stack.
+//----------------------------------------------------------------------
+
+UserThread::UserThread(int id, Thread *t, int stack)
+{
+    tid = id;
+    thread = t;
+    stackTop = stack;
+    func = returnAddr = 0;
+    exited = FALSE;
+    exitCode = 0;
+    joined = FALSE;
+    done = new Semaphore("thread done", 0);
+}
+
+//----------------------------------------------------------------------
+// UserThread::~UserThread
+// 	Deallocate the record of a thread in a user process.
+//----------------------------------------------------------------------
+
+UserThread::~UserThread()
+{
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// Process::Process
+// 	Initialize a process control block.
+//
+//	"id" is the PID of the new process.
+//	"programName" is the file containing the program; we keep a copy,
+//		since it may have come from the memory of another program.
+//	"addrSpace" is the memory the program has been loaded into.
+//	"parentProcess" is the process that started it, NULL if none.
+//----------------------------------------------------------------------
+
+Process::Process(int id, char *programName, AddrSpace *addrSpace,
+		 Process *parentProcess)
+{
+    pid = id;
+    name = new char[strlen(programName) + 1];
+    strcpy(name, programName);
+    space = addrSpace;
+    parent = parentProcess;
+    children = new List<Process *>;
+    exited = FALSE;
+    exiting = FALSE;
+    exitStatus = 0;
+    threads = new List<UserThread *>;
+    numThreads = 0;
+    nextTid = 0;			// the first thread is thread 0
+    joined = FALSE;
+    done = new Semaphore("process done", 0);
+}
+
+//----------------------------------------------------------------------
+// Process::~Process
+// 	Deallocate a process control block.  By now, the process has
+//	exited, and been removed from the process table.
+//----------------------------------------------------------------------
+
+Process::~Process()
+{
+    ASSERT(exited && space == NULL && children->IsEmpty());
+    while (!threads->IsEmpty()) {	// not joined by another thread
+	delete threads->RemoveFront();
+    }
+    delete [] name;
+    delete children;
+    delete threads;
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// Process::Print
+// 	Print the state of a process, for debugging.
+//----------------------------------------------------------------------
+
+void
+Process::Print()
+{
+    cout << "Process " << pid << " (" << name << ")";
+    if (parent != NULL) {
+	cout << ", parent " << parent->pid;
+    }
+    if (exited) {
+	cout << ", exited with " << exitStatus;
+    }
+    cout << "\n";
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ProcessTable
+// 	Initialize an empty process table.  PIDs start at 1.
+//----------------------------------------------------------------------
+
+ProcessTable::ProcessTable()
+{
+    table = new HashTable<int, Process *>(ProcessKey, HashPid);
+    numProcesses = 0;
+    nextPid = 1;
+    toBeDeleted = new List<Process *>;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::~ProcessTable
+// 	Deallocate the process table.  Processes still running when
+//	Nachos halts are taken out of the table, but not cleaned up.
+//----------------------------------------------------------------------
+
+ProcessTable::~ProcessTable()
+{
+    while (!table->IsEmpty()) {
+	HashIterator<int, Process *> iter(table);
+
+	(void) table->Remove(iter.Item()->pid);
+    }
+    DeleteRemoved();
+    delete toBeDeleted;
+    delete table;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Create
+// 	Add a process to the table, giving it the next PID.
+//
+//	"name" is the file containing the program.
+//	"space" is the memory the program has been loaded into.
+//	"parent" is the process that started it, NULL if none.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Create(char *name, AddrSpace *space, Process *parent)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Process *process = new Process(nextPid++, name, space, parent);
+
+    DeleteRemoved();
+    table->Insert(process);
+    numProcesses++;
+    if (parent != NULL) {
+	parent->children->Append(process);
+    }
+    DEBUG(dbgAddr, "Created process " << process->pid << ": " << name);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return process;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Lookup
+// 	Return the process with the given PID, or NULL if there is
+//	no such process (any more).
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Lookup(int pid)
+{
+    Process *process;
+
+    if (table->Find(pid, &process)) {
+	return process;
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Exit
+// 	Record that a process is exiting.  The calling thread then exits
+//	with ThreadExit, and any other threads in the process are stopped
+//	when they next try to run user code; the process is done when
+//	the last of them has exited.
+//
+//	"status" is the exit status, for the parent.  If more than one
+//		thread calls Exit, the first one wins.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Exit(Process *process, int status)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(!process->exited);
+    DEBUG(dbgAddr, "Process " << process->pid << " exits with " << status);
+    if (!process->exiting) {
+	process->exiting = TRUE;
+	process->exitStatus = status;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Finish
+// 	The last thread in a process has exited, so free the memory of
+//	the process.  Its children no longer have a parent to wait for
+//	them, so those that have already exited are removed from the
+//	table.  The process itself stays in the table until its parent
+//	calls Join, unless it has no parent.
+//
+//	Called, with interrupts disabled, by the last thread running in 
+//	the process, which must not touch the address space again.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Finish(Process *process)
+{
+    ASSERT(!process->exited && process->numThreads == 0);
+    DEBUG(dbgAddr, "Process " << process->pid << " is done");
+
+    DeleteRemoved();
+    process->exited = TRUE;
+    delete process->space;
+    process->space = NULL;
+
+    while (!process->children->IsEmpty()) {	// orphan the children
+	Process *child = process->children->RemoveFront();
+
+	child->parent = NULL;
+	if (child->exited) {
+	    Remove(child);
+	}
+    }
+    if (process->parent == NULL) {
+	Remove(process);		// nobody to Join us
+    } else {
+	process->done->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Join
+// 	Wait for a child process to exit, then remove it from the table
+//	and return its exit status.  Returns -1 right away if "pid" is
+//	not a child of "parent", or someone is already waiting for it.
+//
+//	"parent" is the calling process.
+//	"pid" is the child to wait for.
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Join(Process *parent, int pid)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Process *child = Lookup(pid);
+    int status;
+
+    if (child == NULL || child->parent != parent || child->joined) {
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return -1;
+    }
+    child->joined = TRUE;
+    child->done->P();			// returns right away if exited
+
+    ASSERT(child->exited);
+    status = child->exitStatus;
+    parent->children->Remove(child);
+    Remove(child);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return status;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::AddThread
+// 	Record a new thread in a process, and give it the next thread ID.
+//
+//	"thread" is the kernel thread that will run it.
+//	"stackTop" is the top of its user stack, 0 for the first thread.
+//----------------------------------------------------------------------
+
+UserThread *
+ProcessTable::AddThread(Process *process, Thread *thread, int stackTop)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    UserThread *userThread;
+
+    ASSERT(!process->exited);
+    userThread = new UserThread(process->nextTid++, thread, stackTop);
+    process->threads->Append(userThread);
+    process->numThreads++;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return userThread;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ThreadExit
+// 	Record that a thread in a process has exited, and give back its
+//	user stack.  If it was the last one, the process is done.
+//
+//	Called by the exiting thread, which then calls Thread::Finish.
+//	We return with interrupts still disabled, so that no other
+//	thread can run until this one is off the CPU: if this was the 
+//	last thread, another thread creating or exiting a process 
+//	could otherwise free the process control block while we are 
+//	still using it.
+//
+//	"code" is the exit code, for ThreadJoin.  If the last thread 
+//		exits without anyone calling Exit, it is also the exit
+//		status of the process.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::ThreadExit(Process *process, Thread *thread, int code)
+{
+    ListIterator<UserThread *> iter(process->threads);
+    UserThread *userThread = NULL;
+
+    (void) kernel->interrupt->SetLevel(IntOff);	// until Thread::Finish
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->thread == thread && !iter.Item()->exited) {
+	    userThread = iter.Item();
+	    break;
+	}
+    }
+    ASSERT(userThread != NULL);
+    DEBUG(dbgAddr, "Thread " << userThread->tid << " of process " 
+		<< process->pid << " exits with " << code);
+
+    userThread->exited = TRUE;
+    userThread->exitCode = code;
+    userThread->thread = NULL;		// about to be deleted
+    if (userThread->stackTop != 0) {
+	process->space->FreeStack(userThread->stackTop);
+    }
+    userThread->done->V();
+
+    if (--process->numThreads == 0) {
+	if (!process->exiting) {
+	    process->exitStatus = code;
+	}
+	Finish(process);
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ThreadJoin
+// 	Wait for another thread in a process to exit, then forget about
+//	it and return its exit code.  Returns -1 right away if there is
+//	no such thread, or it is the caller, or someone is already 
+//	waiting for it.
+//
+//	"tid" is the thread to wait for.
+//----------------------------------------------------------------------
+
+int
+ProcessTable::ThreadJoin(Process *process, int tid)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    ListIterator<UserThread *> iter(process->threads);
+    UserThread *userThread = NULL;
+    int code;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->tid == tid) {
+	    userThread = iter.Item();
+	    break;
+	}
+    }
+    if (userThread == NULL || userThread->joined 
+		|| userThread->thread == kernel->currentThread) {
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return -1;
+    }
+    userThread->joined = TRUE;
+    userThread->done->P();		// returns right away if exited
+
+    ASSERT(userThread->exited);
+    code = userThread->exitCode;
+    process->threads->Remove(userThread);
+    delete userThread;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return code;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Remove
+// 	Take a process that has exited out of the table.  We can't
+//	delete the process control block yet, in case it is the one
+//	the current thread is exiting from; that is done the next time
+//	a process is created or exits.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Remove(Process *process)
+{
+    ASSERT(process->exited);
+    (void) table->Remove(process->pid);
+    numProcesses--;
+    toBeDeleted->Append(process);
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::DeleteRemoved
+// 	Free the control blocks of processes removed from the table
+//	earlier, whose threads have all finished by now.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::DeleteRemoved()
+{
+    while (!toBeDeleted->IsEmpty()) {
+	delete toBeDeleted->RemoveFront();
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Print
+// 	Print the processes in the table, for debugging.
+//----------------------------------------------------------------------
+
+static void
+ProcessPrint(Process *process)
+{
+    process->Print();
+}
+
+void
+ProcessTable::Print()
+{
+    cout << "Process table: " << numProcesses << " processes\n";
+    table->Apply(ProcessPrint);
+}
@@ -0,0 +1,140 @@
+// process.h
+//	Data structures to keep track of user processes -- which programs
+//	are running, which program started which, and how they exited.
+//
+//	Every process has a process ID (PID), unique for as long as
+//	Nachos runs.  The process table maps PIDs to processes, and
+//	grows as needed, so there is no limit on the number of processes
+//	other than memory.
+//
+//	A process that has exited stays in the table (as a "zombie") until
+//	its parent collects its exit status with Join, or until the parent
+//	exits too.  Processes started from the command line have no parent.
+//
+//	A process can run several threads, started with ThreadFork, which
+//	share its address space but each have their own user stack and
+//	registers.  The process exits when one of its threads calls Exit,
+//	or when its last thread calls ThreadExit; when one thread calls
+//	Exit, the others are stopped the next time they would go back to
+//	running user code.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include "copyright.h"
+#include "list.h"
+#include "hash.h"
+
+class AddrSpace;
+class Semaphore;
+class Thread;
+
+// The following class records a thread running in a user process, so
+// that the other threads in the process can wait for it with ThreadJoin.
+
+class UserThread {
+  public:
+    UserThread(int id, Thread *t, int stack);	// initialize a record
+    ~UserThread();				// deallocate it
+
+    int tid;			// thread ID, unique within the process
+    Thread *thread;		// the kernel thread running it
+    int stackTop;		// user stack it runs on, 0 if the program's
+    				// own stack
+    int func;			// where it starts running
+    int returnAddr;		// where it goes if "func" returns
+    bool exited;		// has it exited?
+    int exitCode;		// if so, the value passed to ThreadExit
+    bool joined;		// is another thread waiting for it?
+    Semaphore *done;		// signalled when it exits
+};
+
+// The following class defines a "process control block" -- a user
+// program, and the address space it runs in.
+
+class Process {
+  public:
+    Process(int id, char *programName, AddrSpace *addrSpace,
+	    Process *parentProcess);	// initialize a process
+    ~Process();				// deallocate a process
+
+    int getPid() { return pid; }
+    char *getName() { return name; }
+    Process *getParent() { return parent; }
+    AddrSpace *getSpace() { return space; }
+    bool hasExited() { return exited; }
+    bool isExiting() { return exiting; }	// has a thread called Exit?
+    int getExitStatus() { return exitStatus; }
+    int NumThreads() { return numThreads; }
+
+    void Print();
+
+  private:
+    int pid;			// process ID
+    char *name;			// the program being run
+    AddrSpace *space;		// its memory, NULL once it has exited
+    Process *parent;		// who started us, NULL if nobody (left)
+    List<Process *> *children;	// processes we started, still in the table
+    bool exited;		// have we exited?
+    bool exiting;		// are we waiting for our threads to stop?
+    int exitStatus;		// if so, the value passed to Exit
+    List<UserThread *> *threads;// our threads, running or not yet joined
+    int numThreads;		// how many of them are still running
+    int nextTid;		// ID for the next thread forked
+    bool joined;		// is our parent waiting for us in Join?
+    Semaphore *done;		// signalled when we exit
+
+    friend class ProcessTable;
+};
+
+// The following class defines the process table.
+
+class ProcessTable {
+  public:
+    ProcessTable();			// initialize an empty table
+    ~ProcessTable();			// deallocate the table
+
+    Process *Create(char *name, AddrSpace *space, Process *parent);
+					// Add a new process, with
+					// a new PID
+    Process *Lookup(int pid);		// Find a process, NULL if none
+    void Exit(Process *process, int status);
+    					// The process is done; stop
+					// all of its threads
+    int Join(Process *parent, int pid);	// Wait for a child to exit,
+					// and return its exit status
+
+    UserThread *AddThread(Process *process, Thread *thread, int stackTop);
+    					// Record a new thread in the 
+					// process, with a new thread ID
+    void ThreadExit(Process *process, Thread *thread, int code);
+    					// A thread of the process is done;
+					// if it was the last, so is the process.
+					// Leaves interrupts off for Finish
+    int ThreadJoin(Process *process, int tid);
+    					// Wait for another thread of the
+					// process to exit, and return
+					// its exit code
+    int NumProcesses() { return numProcesses; }
+
+    void Print();			// Print the processes in the table
+
+  private:
+    HashTable<int, Process *> *table;	// all processes, by PID
+    int numProcesses;			// how many are in the table
+    int nextPid;			// PID for the next process created
+    List<Process *> *toBeDeleted;	// processes that have been
+					// removed from the table, but
+					// whose thread may still be running
+
+    void Finish(Process *process);	// the last thread of a process
+    					// has exited
+    void Remove(Process *process);	// take a process out of the table
+    void DeleteRemoved();		// free processes removed earlier
+};
+
+#endif // PROCESS_H
@@ -39,6 +39,8 @@ SynchConsoleInput::~SynchConsoleInput()
 //----------------------------------------------------------------------
 // SynchConsoleInput::GetChar
 //      Read a character typed at the keyboard, waiting if necessary.
+//	The keyboard only interrupts while we are waiting, and then
+//	delivers everything typed so far, so most calls don't wait.
 //----------------------------------------------------------------------
 
 char
@@ -47,12 +49,53 @@ SynchConsoleInput::GetChar()
     char ch;
 
     lock->Acquire();
-    waitFor->P();	// wait for EOF or a char to be available.
+    while (!consoleInput->IsAvailable()) {
+	consoleInput->Arm();
+	waitFor->P();	// wait for EOF or a char to be available.
+    }
     ch = consoleInput->GetChar();
     lock->Release();
     return ch;
 }
 
+//----------------------------------------------------------------------
+// SynchConsoleInput::ReadLine
+//      Read characters typed at the keyboard, up to and including the
+//	next newline, waiting if necessary.  The line is null-terminated.
+//	Returns the number of characters read, 0 at end of file.
+//
+//	"buffer" -- where to put the line
+//	"size" -- the size of "buffer"; longer lines are returned in
+//		pieces of "size" - 1 characters
+//----------------------------------------------------------------------
+
+int
+SynchConsoleInput::ReadLine(char *buffer, int size)
+{
+    int count = 0;
+    char ch;
+
+    ASSERT(size > 0);
+    lock->Acquire();
+    while (count < size - 1) {
+	while (!consoleInput->IsAvailable()) {
+	    consoleInput->Arm();
+	    waitFor->P();
+	}
+	ch = consoleInput->GetChar();
+	if (ch == EOF) {
+	    break;
+	}
+	buffer[count++] = ch;
+	if (ch == '\n') {
+	    break;
+	}
+    }
+    buffer[count] = '\0';
+    lock->Release();
+    return count;
+}
+
 //----------------------------------------------------------------------
 // SynchConsoleInput::CallBack
 //      Interrupt handler called when keystroke is hit; wake up
@@ -106,6 +149,28 @@ SynchConsoleOutput::PutChar(char ch)
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchConsoleOutput::PutString
+//      Write a string of characters to the console display, waiting 
+//	if necessary.  The string is handed to the display a buffer
+//	full at a time, so we only wait once per buffer, not once per
+//	character, and nobody else's output is mixed in with it.
+//
+//	"buffer" -- the characters to write
+//	"size" -- how many there are
+//----------------------------------------------------------------------
+
+void
+SynchConsoleOutput::PutString(char *buffer, int size)
+{
+    lock->Acquire();
+    for (int done = 0; done < size; done += ConsoleBufferSize) {
+	consoleOutput->PutString(buffer + done, min(size - done, ConsoleBufferSize));
+	waitFor->P();
+    }
+    lock->Release();
+}
+
 //----------------------------------------------------------------------
 // SynchConsoleOutput::CallBack
 //      Interrupt handler called when it's safe to send the next 
@@ -24,10 +24,10 @@ class SynchConsoleInput : public CallBackObj {
   public:
     SynchConsoleInput(char *inputFile); // Initialize the console device
     ~SynchConsoleInput();		// Deallocate console device
-	
-	void Disable() { consoleInput->Disable(); }// 2015.11.25
 
     char GetChar();		// Read a character, waiting if necessary
+    int ReadLine(char *buffer, int size);
+    				// Read a line, waiting if necessary
     
   private:
     ConsoleInput *consoleInput;	// the hardware keyboard
@@ -43,6 +43,9 @@ class SynchConsoleOutput : public CallBackObj {
     ~SynchConsoleOutput();
 
     void PutChar(char ch);	// Write a character, waiting if necessary
+    void PutString(char *buffer, int size);
+    				// Write "size" characters, waiting
+				// once per buffer full
    
   private:
     ConsoleOutput *consoleOutput;// the hardware display
@@ -34,6 +34,16 @@
 #define SC_ExecV	13
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
+#define SC_Sleep	16
+#define SC_SetTickets	17
+#define SC_PutString	18
+#define SC_ReadLine	19
+#define SC_HostId	20
+#define SC_Send		21
+#define SC_Receive	22
+#define SC_TryReceive	23
+#define SC_SendBatch	24
+#define SC_ReceiveBatch	25
 #define SC_Add		42
 #define SC_MSG		100
 
@@ -149,6 +159,31 @@ int Seek(int position, OpenFileId id);
 int Close(OpenFileId id);
 
 
+/* Put the calling thread to sleep for at least "ticks" units of
+ * simulated time, without using the CPU in the meantime.
+ */
+void Sleep(int ticks);
+
+/* Set the number of tickets held by the calling thread, which decides
+ * its share of the CPU under the stride scheduler (-sched stride).
+ * Return the previous number of tickets, or -1 if "tickets" is out 
+ * of range.
+ */
+int SetTickets(int tickets);
+
+/* Write the null-terminated string "str" to the console display, all 
+ * at once.  Return the number of characters written, or -1 if "str"
+ * is not a valid string.
+ */
+int PutString(char *str);
+
+/* Read a line typed at the console keyboard into "buffer", including
+ * the newline, and null-terminate it.  At most "size" - 1 characters
+ * are read; a longer line is returned in pieces.  Return the number
+ * of characters read, 0 at end of input, or -1 if "buffer" is not valid.
+ */
+int ReadLine(char *buffer, int size);
+
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 
  *
@@ -156,7 +191,8 @@ int Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread, on a stack of its own.  If "func" returns, the
+ * thread exits as if it had called ThreadExit with the return value.
  * Return a positive ThreadId on success, negative error code on failure
  */
 ThreadId ThreadFork(void (*func)());
@@ -174,9 +210,68 @@ int ThreadJoin(ThreadId id);
 
 /*
  * Deletes current thread and returns ExitCode to every waiting lokal thread.
+ * When the last thread in a program calls ThreadExit, the program exits;
+ * when any thread calls Exit, all of them stop.
  */
 void ThreadExit(int ExitCode);	
 
+/* Message passing between user programs on different Nachos machines,
+ * through the mailboxes of the post office.  Each machine is started
+ * with "-net" and its own "-m" machine id.  Delivery is unreliable 
+ * (see "-n"): a message arrives whole, or not at all.  A message's
+ * "reply-to" mailbox is the one it was sent to, so a reply to it goes
+ * to the same mailbox number on the sending machine.
+ */
+
+/* Largest message, in bytes */
+#define MaxMessageSize	1024
+
+/* Returned by TryReceive when no message is waiting */
+#define NoMessage	-2
+
+/* One message, for SendBatch and ReceiveBatch */
+typedef struct {
+    int host;		/* machine sent to, or received from */
+    int box;		/* mailbox sent to, or received in */
+    char *data;		/* the message */
+    int size;		/* its size; for ReceiveBatch, the size of "data"
+			 * going in, and of the message coming out */
+} MailMessage;
+
+/* Return the machine id of this Nachos (the "-m" argument). */
+int HostId();
+
+/* Send "size" bytes from "data" as one message to mailbox "box" on 
+ * machine "host".  Return "size", or -1 if the arguments are invalid
+ * or the network is not up.
+ */
+int Send(int host, int box, char *data, int size);
+
+/* Wait for a message to arrive in mailbox "box", copy at most "size" 
+ * bytes of it into "buffer", and, unless "fromHost" is 0, store the
+ * machine it came from there.  Return the number of bytes copied, or
+ * -1 if the arguments are invalid or the network is not up.
+ */
+int Receive(int box, char *buffer, int size, int *fromHost);
+
+/* The same as Receive, but return NoMessage right away, instead of 
+ * waiting, if no message is waiting.
+ */
+int TryReceive(int box, char *buffer, int size, int *fromHost);
+
+/* Send each of the "count" messages in "msgs".  Return how many were 
+ * sent; sending stops at the first invalid one.
+ */
+int SendBatch(MailMessage *msgs, int count);
+
+/* Receive up to "count" messages from mailbox "box" into "msgs", 
+ * waiting for the first one, but not for the rest.  The "data" and
+ * "size" of each entry say where to put the message; "host" and "size"
+ * are set to where it came from and how long it was.  Return how many
+ * were received, or -1 if the arguments are invalid.
+ */
+int ReceiveBatch(int box, MailMessage *msgs, int count);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */